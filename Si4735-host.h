@@ -0,0 +1,143 @@
+/* Arduino Si4735 Library
+ * See the README file for author and licensing information. In case it's
+ * missing from your distribution, use the one here as the authoritative
+ * version: https://github.com/csdexter/Si4735/blob/master/README
+ *
+ * This library is for use with the SparkFun Si4735 Shield or Breakout Board.
+ * See the example sketches to learn how to use the library in your code.
+ *
+ * This file provides the (small) subset of the Arduino core the library
+ * depends on, so that it can be built on a Linux host. It is pulled in by
+ * Si4735.h when SI4735_LINUX is defined and shouldn't be included directly.
+ */
+
+#ifndef _SI4735_HOST_H_INCLUDED
+#define _SI4735_HOST_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+//There is no Arduino SPI or Wire library on the host
+#if !defined(SI4735_NOSPI)
+# define SI4735_NOSPI
+#endif
+#if !defined(SI4735_NOI2C)
+# define SI4735_NOI2C
+#endif
+
+//Si4735 is a big-endian 16-bit world, keep word 16 bits wide like on AVR
+typedef uint8_t byte;
+typedef uint16_t word;
+typedef bool boolean;
+
+inline word makeWord(word w) { return w; }
+inline word makeWord(byte h, byte l) { return (h << 8) | l; }
+#define word(...) makeWord(__VA_ARGS__)
+
+#define lowByte(w) ((byte)((w) & 0xFF))
+#define highByte(w) ((byte)((w) >> 8))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) \
+    ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+//Not macros as on the Arduino, those would break the standard headers 
+//included after this one; mind that both arguments have the same type
+using std::min;
+using std::max;
+#define constrain(amt, low, high) \
+    ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+//Flash and RAM share one address space on the host, so PROGMEM is a no-op.
+//The pgm_read_*() accessors dereference with the type of the pointee, which
+//also makes pgm_read_word() on a table of pointers work on 64-bit hosts.
+#define PROGMEM
+#define PGM_P const char *
+#define pgm_read_byte(addr) (*(addr))
+#define pgm_read_word(addr) (*(addr))
+#define pgm_read_dword(addr) (*(addr))
+#define strncpy_P strncpy
+#define memcpy_P memcpy
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+
+//Pin numbers referenced by the library's defaults; the bus pins belong to
+//the kernel drivers on the host and are never mapped to a GPIO line.
+#define SS 0xFD
+#define SCK 0xFD
+#define MISO 0xFD
+#define SCL 0xFD
+
+//Pin I/O goes to Si4735_hostPins when set (see Si4735GPIO in 
+//Si4735-linux.h), otherwise the pin functions below do nothing.
+class Si4735HostPins
+{
+    public:
+        virtual ~Si4735HostPins() {}
+        virtual void pinMode(byte pin, byte mode) = 0;
+        virtual void digitalWrite(byte pin, byte value) = 0;
+        virtual int digitalRead(byte pin) = 0;
+};
+
+extern Si4735HostPins* Si4735_hostPins;
+
+inline void pinMode(byte pin, byte mode) {
+    if(Si4735_hostPins) Si4735_hostPins->pinMode(pin, mode);
+}
+inline void digitalWrite(byte pin, byte value) {
+    if(Si4735_hostPins) Si4735_hostPins->digitalWrite(pin, value);
+}
+inline int digitalRead(byte pin) {
+    return Si4735_hostPins ? Si4735_hostPins->digitalRead(pin) : LOW;
+}
+
+inline unsigned long micros(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)now.tv_sec * 1000000UL + now.tv_nsec / 1000;
+}
+
+inline unsigned long millis(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)now.tv_sec * 1000UL + now.tv_nsec / 1000000;
+}
+
+inline void delayMicroseconds(unsigned int us) {
+    struct timespec wait = {(time_t)(us / 1000000), (long)(us % 1000000) * 1000};
+
+    while(nanosleep(&wait, &wait));
+}
+
+inline void delay(unsigned long ms) {
+    struct timespec wait = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000};
+
+    while(nanosleep(&wait, &wait));
+}
+
+inline void yield(void) {}
+
+//Byte sink, the part of Arduino's Print the library writes to
+class Print
+{
+    public:
+        virtual ~Print() {}
+        virtual size_t write(uint8_t value) = 0;
+        virtual size_t write(const uint8_t *buffer, size_t size) {
+            size_t n = 0;
+
+            while(size--) n += write(*buffer++);
+            return n;
+        };
+};
+
+#endif
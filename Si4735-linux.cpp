@@ -0,0 +1,1529 @@
+/* Arduino Si4735 Library
+ * See the README file for author and licensing information. In case it's
+ * missing from your distribution, use the one here as the authoritative
+ * version: https://github.com/csdexter/Si4735/blob/master/README
+ *
+ * This library is for use with the SparkFun Si4735 Shield or Breakout Board.
+ * See the example sketches to learn how to use the library in your code.
+ *
+ * This is the code file for the Linux-only facilities of the library.
+ * See the header file for better function documentation.
+ */
+
+#include "Si4735-linux.h"
+#include "Si4735-private.h"
+
+#if defined(SI4735_LINUX)
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+#include <linux/gpio.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <linux/spi/spidev.h>
+#include <new>
+
+Si4735HostPins* Si4735_hostPins = NULL;
+
+static int Si4735_open(const char* path, int flags){
+    return ::open(path, flags);
+}
+
+static int Si4735_ioctl(int fd, unsigned long request, void* arg){
+    return ::ioctl(fd, request, arg);
+}
+
+const Si4735_Syscall_Ops Si4735_syscalls = {Si4735_open, ::close, 
+                                            Si4735_ioctl, ::read};
+
+//Reads a little-endian field of size bytes at data, the other half of
+//Si4735RDSRecorder::writeLE()
+static uint32_t Si4735_readLE(const byte* data, byte size){
+    uint32_t value = 0;
+
+    while(size--) value = (value << 8) | data[size];
+
+    return value;
+}
+
+bool Si4735RDSReplayer::open(const char* path){
+    Si4735_Capture_Header header;
+    struct stat info;
+    void* map;
+    int fd;
+
+    close();
+    fd = ::open(path, O_RDONLY);
+    if(fd < 0) return false;
+    if(fstat(fd, &info) ||
+       (size_t)info.st_size < sizeof(Si4735_Capture_Header)) {
+        ::close(fd);
+        return false;
+    }
+    map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    //The mapping stays valid after the descriptor is gone
+    ::close(fd);
+    if(map == MAP_FAILED) return false;
+    //We are going to walk the capture front to back exactly once
+    madvise(map, info.st_size, MADV_SEQUENTIAL);
+
+    _map = (const byte *)map;
+    _size = info.st_size;
+    getHeader(&header);
+    if(memcmp(header.magic, SI4735_CAPTURE_MAGIC, 4) ||
+       header.version != SI4735_CAPTURE_VERSION ||
+       header.recordSize != sizeof(Si4735_Capture_Record)) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void Si4735RDSReplayer::close(void){
+    if(_map) munmap((void *)_map, _size);
+    _map = NULL;
+    _size = 0;
+}
+
+unsigned long Si4735RDSReplayer::getRecordCount(void){
+    if(!_map) return 0;
+
+    return (_size - sizeof(Si4735_Capture_Header)) /
+           sizeof(Si4735_Capture_Record);
+}
+
+bool Si4735RDSReplayer::getHeader(Si4735_Capture_Header* header){
+    if(!_map) return false;
+
+    memcpy(header->magic, _map, 4);
+    header->version = _map[4];
+    header->recordSize = _map[5];
+    header->frequency = Si4735_readLE(&_map[6], 2);
+    header->reserved[0] = Si4735_readLE(&_map[8], 4);
+    header->reserved[1] = Si4735_readLE(&_map[12], 4);
+
+    return true;
+}
+
+bool Si4735RDSReplayer::getRecord(unsigned long index, 
+                                  Si4735_Capture_Record* record){
+    const byte* data;
+
+    if(index >= getRecordCount()) return false;
+
+    data = _map + sizeof(Si4735_Capture_Header) + 
+           index * sizeof(Si4735_Capture_Record);
+    record->timestamp = Si4735_readLE(data, 4);
+    for(byte n = 0; n < 4; n++) 
+        record->block[n] = Si4735_readLE(&data[4 + n * 2], 2);
+    record->errors = data[12];
+    memset(record->reserved, 0x00, sizeof(record->reserved));
+
+    return true;
+}
+
+unsigned long Si4735RDSReplayer::replay(Si4735RDSDecoder& decoder,
+                                        bool realtime, bool skipErrors){
+    Si4735_Capture_Record record;
+    unsigned long count, fed, start, first, due;
+    word block[4];
+
+    count = getRecordCount();
+    fed = 0;
+    start = millis();
+    first = 0;
+    for(unsigned long i = 0; i < count; i++) {
+        getRecord(i, &record);
+        if(!i) first = record.timestamp;
+        if(skipErrors &&
+           (((record.errors & SI4735_RDS_BLEA_MASK) >>
+             SI4735_RDS_BLEA_SHR) == SI4735_RDS_BLE_U ||
+            ((record.errors & SI4735_RDS_BLEB_MASK) >>
+             SI4735_RDS_BLEB_SHR) == SI4735_RDS_BLE_U ||
+            ((record.errors & SI4735_RDS_BLEC_MASK) >>
+             SI4735_RDS_BLEC_SHR) == SI4735_RDS_BLE_U ||
+            ((record.errors & SI4735_RDS_BLED_MASK) >>
+             SI4735_RDS_BLED_SHR) == SI4735_RDS_BLE_U))
+            continue;
+        if(realtime) {
+            due = record.timestamp - first;
+            if(millis() - start < due) delay(due - (millis() - start));
+        }
+        //decodeRDSBlock() wants a word[]
+        for(byte n = 0; n < 4; n++) block[n] = record.block[n];
+        decoder.decodeRDSBlock(block);
+        fed++;
+    }
+
+    return fed;
+}
+
+Si4735BatchDecoder::Si4735BatchDecoder(){
+    _stations = NULL;
+    _stationCount = 0;
+    _next = 0;
+    _order = NULL;
+    _threadCount = 0;
+    _skipErrors = true;
+}
+
+Si4735BatchDecoder::Station* Si4735BatchDecoder::newStation(void){
+    Station* stations;
+    Station* station;
+
+    stations = (Station *)realloc((void *)_stations, 
+                                  (_stationCount + 1) * sizeof(Station));
+    if(!stations) return NULL;
+    _stations = stations;
+    station = &_stations[_stationCount];
+    memset((void *)station, 0x00, sizeof(Station));
+    station->decoder = new (std::nothrow) Si4735RDSDecoder();
+    if(!station->decoder) return NULL;
+    _stationCount++;
+
+    return station;
+}
+
+int Si4735BatchDecoder::addStation(const Si4735_RDS_Batch* batch){
+    Station* station;
+
+    station = newStation();
+    if(!station) return -1;
+    station->batch = *batch;
+
+    return _stationCount - 1;
+}
+
+int Si4735BatchDecoder::addCapture(Si4735RDSReplayer& replayer){
+    Si4735_Capture_Record record;
+    Station* station;
+    unsigned long count;
+    uint16_t* blocks;
+    uint8_t* errors;
+
+    count = replayer.getRecordCount();
+    if(!count) return -1;
+    //One allocation: four arrays of blocks, then the error fields
+    blocks = (uint16_t *)malloc(count * (4 * sizeof(uint16_t) + 
+                                         sizeof(uint8_t)));
+    if(!blocks) return -1;
+    station = newStation();
+    if(!station) {
+        free(blocks);
+        return -1;
+    };
+    errors = (uint8_t *)(blocks + 4 * count);
+    for(unsigned long i = 0; i < count; i++) {
+        replayer.getRecord(i, &record);
+        for(byte n = 0; n < 4; n++) blocks[n * count + i] = record.block[n];
+        errors[i] = record.errors;
+    }
+    station->owned = blocks;
+    station->batch.count = count;
+    for(byte n = 0; n < 4; n++) station->batch.block[n] = blocks + n * count;
+    station->batch.errors = errors;
+
+    return _stationCount - 1;
+}
+
+void Si4735BatchDecoder::clear(void){
+    for(unsigned int i = 0; i < _stationCount; i++) {
+        free(_stations[i].owned);
+        delete _stations[i].decoder;
+    }
+    free((void *)_stations);
+    free(_order);
+    _stations = NULL;
+    _order = NULL;
+    _stationCount = 0;
+    _threadCount = 0;
+}
+
+bool Si4735BatchDecoder::run(byte threads, bool skipErrors){
+    unsigned int* order;
+    unsigned int j, station;
+    bool failed = false;
+
+    if(!threads) return false;
+    order = (unsigned int *)realloc(_order, 
+                                    (_stationCount + 1) * sizeof(unsigned int));
+    if(!order) return false;
+    _order = order;
+    //Largest first, so that no thread is left with a big one at the end
+    for(unsigned int i = 0; i < _stationCount; i++) {
+        station = i;
+        for(j = i; j && _stations[_order[j - 1]].batch.count < 
+                        _stations[station].batch.count; j--)
+            _order[j] = _order[j - 1];
+        _order[j] = station;
+    }
+    _skipErrors = skipErrors;
+    _next = 0;
+    _threadCount = 0;
+    for(byte i = 0; i < min(threads, (byte)SI4735_BATCH_THREADS); i++) {
+        memset((void *)&_threads[i].stats, 0x00, 
+               sizeof(Si4735_Batch_Thread_Stats));
+        _threads[i].decoder = this;
+        if(pthread_create(&_threads[i].thread, NULL, runThread, 
+                          &_threads[i])) {
+            failed = true;
+            break;
+        };
+        _threadCount++;
+    }
+    for(byte i = 0; i < _threadCount; i++) 
+        pthread_join(_threads[i].thread, NULL);
+
+    return !failed;
+}
+
+Si4735RDSDecoder* Si4735BatchDecoder::getDecoder(unsigned int station){
+    return ((station < _stationCount) ? _stations[station].decoder : NULL);
+}
+
+bool Si4735BatchDecoder::getThreadStats(byte thread, 
+                                        Si4735_Batch_Thread_Stats* stats){
+    if(thread >= _threadCount) return false;
+    *stats = _threads[thread].stats;
+
+    return true;
+}
+
+unsigned long Si4735BatchDecoder::getRate(void){
+    unsigned long long groups = 0, busy = 0;
+
+    for(byte i = 0; i < _threadCount; i++) {
+        groups += _threads[i].stats.groups;
+        busy += _threads[i].stats.busy;
+    }
+
+    return (busy ? groups * 1000000ULL / busy : 0);
+}
+
+//CPU time of the calling thread, in microseconds: what it cost on whichever
+//core it ran, however many other threads shared that
+static unsigned long long Si4735_threadTime(void){
+    struct timespec now;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (unsigned long long)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+void* Si4735BatchDecoder::runThread(void* thread){
+    Thread* self = (Thread *)thread;
+    Si4735BatchDecoder* decoder = self->decoder;
+    Station* station;
+    unsigned int next;
+    unsigned long long start;
+
+    while((next = __atomic_fetch_add(&decoder->_next, 1, 
+                                     __ATOMIC_RELAXED)) < 
+          decoder->_stationCount) {
+        station = &decoder->_stations[decoder->_order[next]];
+        start = Si4735_threadTime();
+        self->stats.decoded += decoder->decode(station);
+        self->stats.busy += Si4735_threadTime() - start;
+        self->stats.groups += station->batch.count;
+        self->stats.stations++;
+    }
+
+    return NULL;
+}
+
+//Sets use[i] for the groups worth decoding: good enough (see skipErrors) and
+//of a type the decoder gets more than PI, TP and PTY out of; good[i] is set
+//for every group that's good enough. Cheap next to decodeRDSBlock(), which
+//is where the time goes: what the batch saves is the groups it doesn't 
+//decode, not the screening.
+static void Si4735_classifyGroups(const uint16_t* __restrict__ B,
+                                  const uint8_t* __restrict__ errors,
+                                  uint8_t* __restrict__ good,
+                                  uint8_t* __restrict__ use,
+                                  unsigned long count, bool skipErrors){
+    for(unsigned long i = 0; i < count; i++) {
+        uint32_t e = (errors ? errors[i] : 0);
+        //A 2-bit BLE field is SI4735_RDS_BLE_U (3) iff both its bits are
+        uint32_t ok = !skipErrors || !(e & (e >> 1) & 0x55);
+        uint32_t type = (B[i] & SI4735_RDS_TYPE_MASK) >> SI4735_RDS_TYPE_SHR;
+
+        good[i] = ok;
+        use[i] = ok & (((uint32_t)SI4735_GROUPS_STATEFUL >> type) & 1);
+    }
+}
+
+unsigned long Si4735BatchDecoder::decode(Station* station){
+    const Si4735_RDS_Batch* batch = &station->batch;
+    uint8_t good[SI4735_BATCH_CHUNK], use[SI4735_BATCH_CHUNK];
+    unsigned long chunk, last, identity = 0, decoded = 0;
+    bool identityUsed = false;
+    word block[4];
+
+    //Exactly what a brand new decoder starts from, also on later runs
+    *station->decoder = Si4735RDSDecoder();
+    for(unsigned long base = 0; base < batch->count; base += chunk) {
+        chunk = min(batch->count - base, (unsigned long)SI4735_BATCH_CHUNK);
+        Si4735_classifyGroups(batch->block[1] + base, 
+                              (batch->errors ? batch->errors + base : NULL),
+                              good, use, chunk, _skipErrors);
+        //Nearly always the very last one
+        for(last = chunk; last && !good[last - 1]; last--);
+        if(last) {
+            identity = base + last;
+            identityUsed = use[last - 1];
+        };
+        for(unsigned long i = 0; i < chunk; i++) {
+            if(!use[i]) continue;
+            for(byte n = 0; n < 4; n++) block[n] = batch->block[n][base + i];
+            station->decoder->decodeRDSBlock(block);
+            decoded++;
+        }
+    }
+    //PI, TP and PTY are whatever the last good group said: if that one
+    //wasn't decoded above, decoding it now sets just those
+    if(identity && !identityUsed) {
+        for(byte n = 0; n < 4; n++) block[n] = batch->block[n][identity - 1];
+        station->decoder->decodeRDSBlock(block);
+        decoded++;
+    };
+
+    return decoded;
+}
+
+Si4735LinuxTransport::Si4735LinuxTransport(const Si4735_Syscall_Ops* ops){
+    _ops = (ops ? ops : &Si4735_syscalls);
+    _fd = -1;
+    resetStats();
+}
+
+void Si4735LinuxTransport::close(void){
+    if(_fd < 0) return;
+    _ops->close(_fd);
+    _stats.syscalls++;
+    _fd = -1;
+}
+
+bool Si4735LinuxTransport::openDevice(const char* path){
+    close();
+    resetStats();
+    _fd = _ops->open(path, O_RDWR);
+    _stats.syscalls++;
+    if(_fd < 0) _stats.errors++;
+
+    return _fd >= 0;
+}
+
+bool Si4735LinuxTransport::control(unsigned long request, void* arg){
+    _stats.syscalls++;
+    if(_ops->ioctl(_fd, request, arg) >= 0) return true;
+    _stats.errors++;
+
+    return false;
+}
+
+bool Si4735I2CDev::open(const char* path, byte address){
+    //I2C_RDWR carries the address in every message, no I2C_SLAVE needed
+    _address = address;
+
+    return openDevice(path);
+}
+
+void Si4735I2CDev::write(const byte* command){
+    struct i2c_msg message;
+    struct i2c_rdwr_ioctl_data transfer;
+
+    message.addr = _address;
+    message.flags = 0;
+    message.len = 8;
+    message.buf = (__u8 *)command;
+    transfer.msgs = &message;
+    transfer.nmsgs = 1;
+    control(I2C_RDWR, &transfer);
+    _stats.writes++;
+}
+
+void Si4735I2CDev::read(byte* response, byte length){
+    struct i2c_msg message;
+    struct i2c_rdwr_ioctl_data transfer;
+
+    message.addr = _address;
+    message.flags = I2C_M_RD;
+    message.len = length;
+    message.buf = response;
+    transfer.msgs = &message;
+    transfer.nmsgs = 1;
+    //A failed read must not pass for CTS
+    if(!control(I2C_RDWR, &transfer)) memset(response, 0x00, length);
+    _stats.reads++;
+}
+
+byte Si4735I2CDev::writeRead(const byte* command){
+    struct i2c_msg messages[2];
+    struct i2c_rdwr_ioctl_data transfer;
+    byte status;
+
+    messages[0].addr = _address;
+    messages[0].flags = 0;
+    messages[0].len = 8;
+    messages[0].buf = (__u8 *)command;
+    messages[1].addr = _address;
+    messages[1].flags = I2C_M_RD;
+    messages[1].len = 1;
+    messages[1].buf = &status;
+    transfer.msgs = messages;
+    transfer.nmsgs = 2;
+    if(!control(I2C_RDWR, &transfer)) status = 0;
+    _stats.writes++;
+    _stats.reads++;
+
+    return status;
+}
+
+bool Si4735SPIDev::open(const char* path, unsigned long speed){
+    __u8 mode = SPI_MODE_0, bits = 8;
+    __u32 hz = speed;
+
+    _speed = speed;
+    if(!openDevice(path)) return false;
+    if(!control(SPI_IOC_WR_MODE, &mode) || 
+       !control(SPI_IOC_WR_BITS_PER_WORD, &bits) ||
+       !control(SPI_IOC_WR_MAX_SPEED_HZ, &hz)) {
+        close();
+        return false;
+    };
+
+    return true;
+}
+
+void Si4735SPIDev::write(const byte* command){
+    struct spi_ioc_transfer transfer;
+    byte tx[9];
+
+    tx[0] = SI4735_CP_WRITE8;
+    memcpy(&tx[1], command, 8);
+    memset((void *)&transfer, 0x00, sizeof(transfer));
+    transfer.tx_buf = (unsigned long)tx;
+    transfer.len = sizeof(tx);
+    transfer.speed_hz = _speed;
+    transfer.bits_per_word = 8;
+    control(SPI_IOC_MESSAGE(1), &transfer);
+    _stats.writes++;
+}
+
+void Si4735SPIDev::read(byte* response, byte length){
+    struct spi_ioc_transfer transfer;
+    byte tx[17], rx[17];
+
+    //The control byte goes out while the first byte comes in, discard it
+    memset(tx, 0x00, sizeof(tx));
+    tx[0] = ((length == 1) ? SI4735_CP_READ1_GPO1 : SI4735_CP_READ16_GPO1);
+    memset((void *)&transfer, 0x00, sizeof(transfer));
+    transfer.tx_buf = (unsigned long)tx;
+    transfer.rx_buf = (unsigned long)rx;
+    transfer.len = length + 1;
+    transfer.speed_hz = _speed;
+    transfer.bits_per_word = 8;
+    if(control(SPI_IOC_MESSAGE(1), &transfer)) 
+        memcpy(response, &rx[1], length);
+    else memset(response, 0x00, length);
+    _stats.reads++;
+}
+
+byte Si4735SPIDev::writeRead(const byte* command){
+    struct spi_ioc_transfer transfers[2];
+    byte tx[9], txs[2], rxs[2];
+
+    tx[0] = SI4735_CP_WRITE8;
+    memcpy(&tx[1], command, 8);
+    txs[0] = SI4735_CP_READ1_GPO1;
+    txs[1] = 0x00;
+    rxs[1] = 0x00;
+    memset((void *)transfers, 0x00, sizeof(transfers));
+    transfers[0].tx_buf = (unsigned long)tx;
+    transfers[0].len = sizeof(tx);
+    transfers[0].speed_hz = _speed;
+    transfers[0].bits_per_word = 8;
+    //SEN has to go up between the write and the read
+    transfers[0].cs_change = 1;
+    transfers[1].tx_buf = (unsigned long)txs;
+    transfers[1].rx_buf = (unsigned long)rxs;
+    transfers[1].len = sizeof(txs);
+    transfers[1].speed_hz = _speed;
+    transfers[1].bits_per_word = 8;
+    if(!control(SPI_IOC_MESSAGE(2), transfers)) rxs[1] = 0x00;
+    _stats.writes++;
+    _stats.reads++;
+
+    return rxs[1];
+}
+
+Si4735GPIO::Si4735GPIO(const Si4735_Syscall_Ops* ops){
+    _ops = (ops ? ops : &Si4735_syscalls);
+    _count = 0;
+    _fd = -1;
+    _syscalls = 0;
+}
+
+bool Si4735GPIO::open(const char* path){
+    close();
+    _fd = _ops->open(path, O_RDWR);
+    _syscalls++;
+    if(_fd < 0) return false;
+    if(!Si4735_hostPins) Si4735_hostPins = this;
+
+    return true;
+}
+
+void Si4735GPIO::close(void){
+    for(byte i = 0; i < _count; i++)
+        if(_lines[i].fd >= 0) {
+            _ops->close(_lines[i].fd);
+            _syscalls++;
+            _lines[i].fd = -1;
+        };
+    if(_fd >= 0) {
+        _ops->close(_fd);
+        _syscalls++;
+        _fd = -1;
+    };
+    if(Si4735_hostPins == this) Si4735_hostPins = NULL;
+}
+
+bool Si4735GPIO::map(byte pin, unsigned int line){
+    if(_count == SI4735_GPIO_LINES) return false;
+
+    _lines[_count].pin = pin;
+    _lines[_count].line = line;
+    _lines[_count].fd = -1;
+    _count++;
+
+    return true;
+}
+
+Si4735GPIO::Line* Si4735GPIO::findLine(byte pin){
+    for(byte i = 0; i < _count; i++)
+        if(_lines[i].pin == pin) return &_lines[i];
+
+    return NULL;
+}
+
+bool Si4735GPIO::requestLine(Line* line, unsigned long long flags){
+    struct gpio_v2_line_request request;
+
+    if(_fd < 0) return false;
+    if(line->fd >= 0) {
+        //Keep the line (and our claim on it), just reconfigure it
+        memset((void *)&request.config, 0x00, sizeof(request.config));
+        request.config.flags = flags;
+        _syscalls++;
+        return _ops->ioctl(line->fd, GPIO_V2_LINE_SET_CONFIG_IOCTL,
+                           &request.config) >= 0;
+    };
+    memset((void *)&request, 0x00, sizeof(request));
+    request.offsets[0] = line->line;
+    request.num_lines = 1;
+    strncpy(request.consumer, "Si4735", sizeof(request.consumer) - 1);
+    request.config.flags = flags;
+    _syscalls++;
+    if(_ops->ioctl(_fd, GPIO_V2_GET_LINE_IOCTL, &request) < 0) return false;
+    line->fd = request.fd;
+
+    return true;
+}
+
+void Si4735GPIO::pinMode(byte pin, byte mode){
+    Line* line;
+
+    line = findLine(pin);
+    if(line) requestLine(line, (mode == OUTPUT) ? GPIO_V2_LINE_FLAG_OUTPUT :
+                                                  GPIO_V2_LINE_FLAG_INPUT);
+}
+
+void Si4735GPIO::digitalWrite(byte pin, byte value){
+    struct gpio_v2_line_values values;
+    Line* line;
+
+    line = findLine(pin);
+    if(!line || line->fd < 0) return;
+    values.bits = (value ? 1 : 0);
+    values.mask = 1;
+    _ops->ioctl(line->fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values);
+    _syscalls++;
+}
+
+int Si4735GPIO::digitalRead(byte pin){
+    struct gpio_v2_line_values values;
+    Line* line;
+
+    line = findLine(pin);
+    if(!line || line->fd < 0) return LOW;
+    values.bits = 0;
+    values.mask = 1;
+    _syscalls++;
+    if(_ops->ioctl(line->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0)
+        return LOW;
+
+    return (values.bits & 1) ? HIGH : LOW;
+}
+
+int Si4735GPIO::requestEvents(byte pin){
+    Line* line;
+
+    line = findLine(pin);
+    if(!line) return -1;
+    if(!requestLine(line, GPIO_V2_LINE_FLAG_INPUT | 
+                          GPIO_V2_LINE_FLAG_EDGE_FALLING)) return -1;
+
+    return line->fd;
+}
+
+//Records are kept a cache line apart, so that readers of one tuner don't
+//slow down the writer of the next
+#define SI4735_SHARED_STRIDE ((sizeof(Si4735_Shared_Tuner) + 63) & ~63)
+
+Si4735Publisher::Si4735Publisher(){
+    _map = NULL;
+    _size = 0;
+    _writing = NULL;
+    _published = 0;
+    _skipped = 0;
+}
+
+bool Si4735Publisher::open(const char* name, byte tuners){
+    Si4735_Shared_Header* header;
+    void* map;
+    size_t size;
+    int fd;
+
+    close();
+    if(!tuners || strlen(name) >= sizeof(_name)) return false;
+    size = sizeof(Si4735_Shared_Header) + tuners * SI4735_SHARED_STRIDE;
+    fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if(fd < 0) return false;
+    if(ftruncate(fd, size)) {
+        ::close(fd);
+        return false;
+    };
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED) return false;
+    //publish() takes its per-tuner write flags from here
+    _writing = (bool *)calloc(tuners, sizeof(bool));
+    if(!_writing) {
+        munmap(map, size);
+        return false;
+    };
+
+    _map = (byte *)map;
+    _size = size;
+    strcpy(_name, name);
+    memset(_map, 0x00, size);
+    header = (Si4735_Shared_Header *)_map;
+    header->version = SI4735_SHARED_VERSION;
+    header->tuners = tuners;
+    header->recordSize = SI4735_SHARED_STRIDE;
+    //Readers check the magic first, it goes in last
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(header->magic, SI4735_SHARED_MAGIC, 4);
+
+    return true;
+}
+
+void Si4735Publisher::close(bool unlink){
+    if(!_map) return;
+    munmap(_map, _size);
+    if(unlink) shm_unlink(_name);
+    free(_writing);
+    _map = NULL;
+    _writing = NULL;
+    _size = 0;
+}
+
+void Si4735Publisher::publish(byte tuner, word frequency,
+                              const Si4735_RX_Metrics* RSQ,
+                              const Si4735_RDS_Data* rds){
+    Si4735_Shared_Tuner* record;
+    bool expected, changes;
+
+    if(!_map || tuner >= ((Si4735_Shared_Header *)_map)->tuners) return;
+    record = (Si4735_Shared_Tuner *)(_map + sizeof(Si4735_Shared_Header) +
+                                     tuner * SI4735_SHARED_STRIDE);
+
+    //The seqlock only works with one writer at a time
+    do {
+        expected = false;
+    } while(!__atomic_compare_exchange_n(&_writing[tuner], &expected, true,
+                                         true, __ATOMIC_ACQUIRE, 
+                                         __ATOMIC_RELAXED));
+
+    //We're the only writer, reading our own record needs no care
+    changes = (frequency && frequency != record->frequency) ||
+              (RSQ && memcmp(RSQ, &record->RSQ, sizeof(Si4735_RX_Metrics))) ||
+              (rds && memcmp(rds, &record->rds, sizeof(Si4735_RDS_Data)));
+    if(changes) {
+        __atomic_store_n(&record->sequence, record->sequence + 1, 
+                         __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        if(frequency && frequency != record->frequency) 
+            record->frequency = frequency;
+        if(RSQ && memcmp(RSQ, &record->RSQ, sizeof(Si4735_RX_Metrics)))
+            record->RSQ = *RSQ;
+        if(rds && memcmp(rds, &record->rds, sizeof(Si4735_RDS_Data)))
+            record->rds = *rds;
+        record->updated = millis();
+        __atomic_store_n(&record->sequence, record->sequence + 1, 
+                         __ATOMIC_RELEASE);
+        _published++;
+    } else _skipped++;
+
+    __atomic_store_n(&_writing[tuner], false, __ATOMIC_RELEASE);
+}
+
+bool Si4735Subscriber::open(const char* name){
+    const Si4735_Shared_Header* header;
+    struct stat info;
+    void* map;
+    int fd;
+
+    close();
+    fd = shm_open(name, O_RDONLY, 0);
+    if(fd < 0) return false;
+    if(fstat(fd, &info) || 
+       (size_t)info.st_size < sizeof(Si4735_Shared_Header)) {
+        ::close(fd);
+        return false;
+    };
+    map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED) return false;
+
+    _map = (const byte *)map;
+    _size = info.st_size;
+    header = (const Si4735_Shared_Header *)_map;
+    if(memcmp(header->magic, SI4735_SHARED_MAGIC, 4) ||
+       header->version != SI4735_SHARED_VERSION ||
+       header->recordSize != SI4735_SHARED_STRIDE ||
+       _size < sizeof(Si4735_Shared_Header) + 
+               header->tuners * SI4735_SHARED_STRIDE) {
+        close();
+        return false;
+    };
+
+    return true;
+}
+
+void Si4735Subscriber::close(void){
+    if(_map) munmap((void *)_map, _size);
+    _map = NULL;
+    _size = 0;
+}
+
+unsigned int Si4735Subscriber::read(byte tuner, 
+                                    Si4735_Shared_Tuner* snapshot){
+    const Si4735_Shared_Tuner* record;
+    uint32_t before, after;
+    unsigned int attempts;
+
+    if(tuner >= getTunerCount()) return 0;
+    record = (const Si4735_Shared_Tuner *)(_map + 
+                                           sizeof(Si4735_Shared_Header) +
+                                           tuner * SI4735_SHARED_STRIDE);
+    attempts = 0;
+    do {
+        attempts++;
+        before = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+        if(before & 1) continue;
+        memcpy((void *)snapshot, (const void *)record, 
+               sizeof(Si4735_Shared_Tuner));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&record->sequence, __ATOMIC_RELAXED);
+        if(before == after) break;
+    } while(true);
+    snapshot->sequence = before;
+
+    return attempts;
+}
+
+Si4735Daemon::Si4735Daemon(){
+    _stationCount = 0;
+    _threadCount = 0;
+    _workers = 0;
+    _pollInterval = 10;
+    _rsqInterval = 1000;
+    _publisher = NULL;
+    _running = false;
+    pthread_mutex_init(&_lock, NULL);
+    pthread_cond_init(&_work, NULL);
+}
+
+Si4735Daemon::~Si4735Daemon(){
+    stop();
+    for(byte i = 0; i < _stationCount; i++)
+        pthread_mutex_destroy(&_stations[i].lock);
+    pthread_cond_destroy(&_work);
+    pthread_mutex_destroy(&_lock);
+}
+
+byte Si4735Daemon::addTuner(Si4735* tuner, byte bus){
+    Station* station;
+
+    if(_running || _stationCount == SI4735_DAEMON_TUNERS || 
+       bus >= SI4735_DAEMON_BUSES) return 0xFF;
+
+    station = &_stations[_stationCount];
+    station->tuner = tuner;
+    station->bus = bus;
+    station->head = station->tail = 0;
+    station->claimed = false;
+    station->generation = station->decoded = 0;
+    station->request = 0;
+    station->tuning = station->rsqPending = station->stuck = false;
+    station->rsqPolled = millis();
+    station->decoder.resetRDS();
+    pthread_mutex_init(&station->lock, NULL);
+    memset((void *)&station->snapshot, 0x00, sizeof(Si4735_Daemon_Snapshot));
+    station->latencySum = 0;
+
+    return _stationCount++;
+}
+
+bool Si4735Daemon::start(byte workers){
+    Thread* thread;
+    bool used[SI4735_DAEMON_BUSES];
+    bool failed = false;
+
+    if(_running || !workers) return false;
+    _workers = min(workers, (byte)SI4735_DAEMON_WORKERS);
+    memset(used, 0x00, sizeof(used));
+    for(byte i = 0; i < _stationCount; i++) {
+        used[_stations[i].bus] = true;
+        _stations[i].home = i % _workers;
+    }
+
+    _running = true;
+    _threadCount = 0;
+    for(byte i = 0; i < SI4735_DAEMON_BUSES + _workers && !failed; i++) {
+        if(i < SI4735_DAEMON_BUSES && !used[i]) continue;
+        thread = &_threads[_threadCount];
+        memset((void *)&thread->stats, 0x00, sizeof(thread->stats));
+        thread->daemon = this;
+        thread->stats.type = ((i < SI4735_DAEMON_BUSES) ? SI4735_DAEMON_IO :
+                              SI4735_DAEMON_WORKER);
+        thread->stats.index = ((i < SI4735_DAEMON_BUSES) ? i : 
+                               i - SI4735_DAEMON_BUSES);
+        if(pthread_create(&thread->thread, NULL, 
+                          ((thread->stats.type == SI4735_DAEMON_IO) ? 
+                           runIO : runWorker), thread)) failed = true;
+        else _threadCount++;
+    }
+    if(failed) stop();
+
+    return !failed;
+}
+
+void Si4735Daemon::stop(void){
+    if(!_running) return;
+
+    pthread_mutex_lock(&_lock);
+    __atomic_store_n(&_running, false, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&_work);
+    pthread_mutex_unlock(&_lock);
+    for(byte i = 0; i < _threadCount; i++) 
+        pthread_join(_threads[i].thread, NULL);
+}
+
+bool Si4735Daemon::tune(byte tuner, word frequency){
+    if(tuner >= _stationCount || !frequency) return false;
+
+    //Picked up by the I/O thread on its next round
+    __atomic_store_n(&_stations[tuner].request, frequency, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+bool Si4735Daemon::getSnapshot(byte tuner, Si4735_Daemon_Snapshot* snapshot){
+    if(tuner >= _stationCount) return false;
+
+    pthread_mutex_lock(&_stations[tuner].lock);
+    *snapshot = _stations[tuner].snapshot;
+    pthread_mutex_unlock(&_stations[tuner].lock);
+
+    return true;
+}
+
+bool Si4735Daemon::getThreadStats(byte thread, 
+                                  Si4735_Daemon_Thread_Stats* stats){
+    if(thread >= _threadCount) return false;
+
+    //Only ever written by the thread itself, a torn read is harmless
+    *stats = _threads[thread].stats;
+
+    return true;
+}
+
+void* Si4735Daemon::runIO(void* thread){
+    ((Thread *)thread)->daemon->pollBus((Thread *)thread);
+
+    return NULL;
+}
+
+void* Si4735Daemon::runWorker(void* thread){
+    ((Thread *)thread)->daemon->decode((Thread *)thread);
+
+    return NULL;
+}
+
+void Si4735Daemon::pollBus(Thread* thread){
+    Station* station;
+    Group* group;
+    Si4735_RX_Metrics RSQ;
+    unsigned long started, round;
+    unsigned int tail, got;
+    word frequency, block[4];
+    bool haveRSQ;
+
+    started = micros();
+    while(__atomic_load_n(&_running, __ATOMIC_ACQUIRE)) {
+        round = micros();
+        got = 0;
+        for(byte i = 0; i < _stationCount; i++) {
+            station = &_stations[i];
+            if(station->bus != thread->stats.index) continue;
+            //Given up on by the watchdog, left alone until retuned
+            if(station->stuck && !__atomic_load_n(&station->request, 
+                                                  __ATOMIC_RELAXED)) continue;
+            station->stuck = false;
+            //RSQ is read in two halves too, so that a chip slow to answer
+            //only holds up its own station; one that is overdue is left to
+            //the watchdog, see Si4735::getRSQ()
+            if(station->rsqPending) {
+                haveRSQ = station->tuner->isRSQReady(&RSQ);
+                if(!haveRSQ) {
+                    if(millis() - station->rsqPolled < _rsqInterval) continue;
+                    haveRSQ = station->tuner->getRSQ(&RSQ);
+                    station->stuck = !haveRSQ;
+                };
+                station->rsqPending = false;
+                if(haveRSQ) {
+                    pthread_mutex_lock(&station->lock);
+                    station->snapshot.RSQ = RSQ;
+                    pthread_mutex_unlock(&station->lock);
+                    if(_publisher) _publisher->publish(i, 0, &RSQ, NULL);
+                };
+            };
+            frequency = __atomic_exchange_n(&station->request, 0, 
+                                            __ATOMIC_ACQUIRE);
+            if(frequency) {
+                station->tuner->startTune(frequency);
+                station->tuning = true;
+                pthread_mutex_lock(&station->lock);
+                station->snapshot.frequency = frequency;
+                pthread_mutex_unlock(&station->lock);
+                if(_publisher) _publisher->publish(i, frequency, NULL, NULL);
+                continue;
+            };
+            if(station->tuning) {
+                //Other tuners on the bus get on with it in the meantime
+                if(!station->tuner->isSeekTuneComplete()) continue;
+                station->tuning = false;
+                __atomic_add_fetch(&station->generation, 1, 
+                                   __ATOMIC_RELEASE);
+            };
+            if(_rsqInterval && millis() - station->rsqPolled >= _rsqInterval) {
+                station->rsqPolled = millis();
+                station->tuner->startRSQ();
+                station->rsqPending = true;
+                //Nothing else may go to the chip until it answers
+                continue;
+            };
+            if(station->tuner->getMode() != SI4735_MODE_FM) continue;
+
+            station->tuner->sendCommand(SI4735_CMD_GET_INT_STATUS);
+            tail = station->tail;
+            while(station->tuner->readRDSBlock(block)) {
+                //Full: the group is read off the chip anyway so that the 
+                //FIFO keeps moving, but goes nowhere
+                if(tail - __atomic_load_n(&station->head, __ATOMIC_ACQUIRE) ==
+                   SI4735_DAEMON_BACKLOG) {
+                    pthread_mutex_lock(&station->lock);
+                    station->snapshot.dropped++;
+                    pthread_mutex_unlock(&station->lock);
+                    continue;
+                };
+                group = &station->backlog[tail % SI4735_DAEMON_BACKLOG];
+                memcpy(group->block, block, sizeof(block));
+                group->timestamp = micros();
+                group->generation = station->generation;
+                tail++;
+                __atomic_store_n(&station->tail, tail, __ATOMIC_RELEASE);
+                got++;
+            }
+        }
+        if(got) {
+            thread->stats.groups += got;
+            pthread_mutex_lock(&_lock);
+            pthread_cond_broadcast(&_work);
+            pthread_mutex_unlock(&_lock);
+        };
+        thread->stats.busy += micros() - round;
+        if(!got) delay(_pollInterval);
+        thread->stats.total = micros() - started;
+    }
+}
+
+bool Si4735Daemon::isPending(Station* station){
+    return __atomic_load_n(&station->tail, __ATOMIC_ACQUIRE) != 
+           __atomic_load_n(&station->head, __ATOMIC_ACQUIRE);
+}
+
+unsigned int Si4735Daemon::drain(Station* station, Thread* thread){
+    Group* group;
+    Si4735_RDS_Data rds;
+    Si4735_RDS_Time time;
+    unsigned long latency, worst;
+    unsigned long long sum;
+    unsigned int head, tail, count;
+    byte generation;
+    bool expected, haveTime;
+
+    expected = false;
+    if(!__atomic_compare_exchange_n(&station->claimed, &expected, true, false,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return 0;
+
+    generation = __atomic_load_n(&station->generation, __ATOMIC_ACQUIRE);
+    if(generation != station->decoded) {
+        //Retuned, start over
+        station->decoder.resetRDS();
+        station->decoded = generation;
+        pthread_mutex_lock(&station->lock);
+        memset((void *)&station->snapshot.rds, 0x00, sizeof(Si4735_RDS_Data));
+        station->snapshot.haveTime = false;
+        pthread_mutex_unlock(&station->lock);
+    };
+    head = station->head;
+    tail = __atomic_load_n(&station->tail, __ATOMIC_ACQUIRE);
+    count = 0;
+    worst = 0;
+    sum = 0;
+    while(head != tail && count < SI4735_DAEMON_BATCH) {
+        group = &station->backlog[head % SI4735_DAEMON_BACKLOG];
+        head++;
+        //Left over from the previous station
+        if(group->generation != generation) continue;
+        station->decoder.decodeRDSBlock(group->block);
+        latency = micros() - group->timestamp;
+        sum += latency;
+        worst = max(worst, latency);
+        count++;
+    }
+    __atomic_store_n(&station->head, head, __ATOMIC_RELEASE);
+
+    if(count) {
+        station->decoder.getRDSData(&rds);
+        haveTime = station->decoder.getRDSTime(&time);
+        pthread_mutex_lock(&station->lock);
+        station->snapshot.rds = rds;
+        if(haveTime) {
+            station->snapshot.haveTime = true;
+            station->snapshot.time = time;
+        };
+        station->snapshot.groups += count;
+        station->latencySum += sum;
+        station->snapshot.latency = station->latencySum / 
+                                    station->snapshot.groups;
+        station->snapshot.maxLatency = max(station->snapshot.maxLatency, 
+                                           worst);
+        pthread_mutex_unlock(&station->lock);
+        if(_publisher) _publisher->publish(station - _stations, 0, NULL, &rds);
+        thread->stats.groups += count;
+    };
+    __atomic_store_n(&station->claimed, false, __ATOMIC_RELEASE);
+
+    return count;
+}
+
+void Si4735Daemon::decode(Thread* thread){
+    struct timespec until;
+    Station* station;
+    unsigned long started, round;
+    unsigned int done, count;
+    byte me, next;
+
+    me = thread->stats.index;
+    next = me;
+    started = micros();
+    while(__atomic_load_n(&_running, __ATOMIC_ACQUIRE)) {
+        round = micros();
+        done = 0;
+        for(byte i = 0; i < _stationCount; i++)
+            if(_stations[i].home == me) done += drain(&_stations[i], thread);
+        //Nothing of our own to do, help whoever is behind; start somewhere
+        //else every time so that the victims get spread out
+        if(!done)
+            for(byte i = 0; i < _stationCount; i++) {
+                station = &_stations[(next + i) % _stationCount];
+                if(station->home == me || !isPending(station)) continue;
+                count = drain(station, thread);
+                if(!count) continue;
+                done += count;
+                thread->stats.steals++;
+                next = (next + i + 1) % _stationCount;
+                break;
+            }
+        if(done) thread->stats.busy += micros() - round;
+        else {
+            //The I/O threads wake us up, the timeout covers the wakeup we
+            //may have missed while looking for work
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_nsec += 5000000;
+            if(until.tv_nsec >= 1000000000) {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000;
+            };
+            pthread_mutex_lock(&_lock);
+            if(__atomic_load_n(&_running, __ATOMIC_ACQUIRE))
+                pthread_cond_timedwait(&_work, &_lock, &until);
+            pthread_mutex_unlock(&_lock);
+        };
+        thread->stats.total = micros() - started;
+    }
+}
+
+Si4735LinkClient::Si4735LinkClient(){
+    _fd = -1;
+    _timeout = 100;
+    _retries = 3;
+    _seq = 0;
+    _received = 0;
+    _synced = false;
+    _inputHead = 0;
+    _inputTail = 0;
+    _onRDS = NULL;
+    _onRSQ = NULL;
+    memset(&_stats, 0x00, sizeof(_stats));
+}
+
+bool Si4735LinkClient::open(const char* path, unsigned long baud){
+    static const struct {
+        unsigned long baud;
+        speed_t speed;
+    } speeds[] = {{9600, B9600}, {19200, B19200}, {38400, B38400},
+                  {57600, B57600}, {115200, B115200}, {230400, B230400},
+                  {460800, B460800}, {921600, B921600}};
+    struct termios tty;
+    byte i;
+
+    close();
+    for(i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++)
+        if(speeds[i].baud == baud) break;
+    if(i == sizeof(speeds) / sizeof(speeds[0])) return false;
+    _fd = ::open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if(_fd < 0) return false;
+    if(tcgetattr(_fd, &tty)) {
+        close();
+        return false;
+    };
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, speeds[i].speed);
+    cfsetospeed(&tty, speeds[i].speed);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
+    if(tcsetattr(_fd, TCSANOW, &tty)) {
+        close();
+        return false;
+    };
+    //Drop whatever the device sent before anyone was listening
+    tcflush(_fd, TCIOFLUSH);
+
+    return true;
+}
+
+void Si4735LinkClient::close(void){
+    if(_fd < 0) return;
+    ::close(_fd);
+    _fd = -1;
+    _received = 0;
+    _synced = false;
+    _inputHead = 0;
+    _inputTail = 0;
+}
+
+bool Si4735LinkClient::sendCommands(const byte* commands, byte count,
+                                    byte* statuses, byte* response){
+    byte reply[SI4735_LINK_PAYLOAD];
+
+    if(!count || count > 8 || count + 16 > SI4735_LINK_PAYLOAD) return false;
+    if(!transact(SI4735_LINK_COMMAND, commands, count * 8, reply, count + 16))
+        return false;
+    if(statuses) memcpy(statuses, reply, count);
+    if(response) memcpy(response, &reply[count], 16);
+
+    return true;
+}
+
+bool Si4735LinkClient::getProperties(const word* properties, byte count,
+                                     word* values){
+    byte request[SI4735_LINK_PAYLOAD], reply[SI4735_LINK_PAYLOAD], batch;
+
+    while(count) {
+        batch = min(count, (byte)(SI4735_LINK_PAYLOAD / 2));
+        for(byte i = 0; i < batch; i++) {
+            request[i * 2] = highByte(properties[i]);
+            request[i * 2 + 1] = lowByte(properties[i]);
+        }
+        if(!transact(SI4735_LINK_GET_PROPERTY, request, batch * 2, reply,
+                     batch * 2))
+            return false;
+        for(byte i = 0; i < batch; i++)
+            values[i] = word(reply[i * 2], reply[i * 2 + 1]);
+        properties += batch;
+        values += batch;
+        count -= batch;
+    }
+
+    return true;
+}
+
+bool Si4735LinkClient::setProperties(const word* properties, 
+                                     const word* values, byte count){
+    byte request[SI4735_LINK_PAYLOAD], batch;
+
+    while(count) {
+        batch = min(count, (byte)(SI4735_LINK_PAYLOAD / 4));
+        for(byte i = 0; i < batch; i++) {
+            request[i * 4] = highByte(properties[i]);
+            request[i * 4 + 1] = lowByte(properties[i]);
+            request[i * 4 + 2] = highByte(values[i]);
+            request[i * 4 + 3] = lowByte(values[i]);
+        }
+        if(!transact(SI4735_LINK_SET_PROPERTY, request, batch * 4, NULL, 0))
+            return false;
+        properties += batch;
+        values += batch;
+        count -= batch;
+    }
+
+    return true;
+}
+
+bool Si4735LinkClient::setStreams(byte streams, word interval){
+    byte request[3] = {streams, highByte(interval), lowByte(interval)};
+
+    return transact(SI4735_LINK_STREAM, request, 3, NULL, 0);
+}
+
+bool Si4735LinkClient::poll(int timeout){
+    //Events are dispatched by receive(), replies are stale ones
+    while(receive(timeout)) timeout = 0;
+
+    return _fd >= 0;
+}
+
+bool Si4735LinkClient::transact(byte type, const byte* payload, byte length,
+                                byte* reply, byte replyLength){
+    byte frame[1 + 3 + SI4735_LINK_PAYLOAD + 2];
+    word crc;
+
+    if(_fd < 0 || length > SI4735_LINK_PAYLOAD) return false;
+    frame[0] = SI4735_LINK_SYNC;
+    frame[1] = length;
+    frame[2] = ++_seq;
+    frame[3] = type;
+    memcpy(&frame[4], payload, length);
+    crc = Si4735_crc16(&frame[1], 3 + length);
+    frame[4 + length] = highByte(crc);
+    frame[4 + length + 1] = lowByte(crc);
+    for(byte attempt = 0; attempt <= _retries; attempt++) {
+        if(attempt) _stats.retries++;
+        if(::write(_fd, frame, 4 + length + 2) != 4 + length + 2) {
+            close();
+            return false;
+        };
+        _stats.framesSent++;
+        while(receive(_timeout)) {
+            //A late reply to an earlier attempt of something else
+            if(_frame[1] != _seq) continue;
+            if(_frame[2] == SI4735_LINK_NAK) return false;
+            if(_frame[2] != (type | SI4735_LINK_REPLY) || 
+               _frame[0] != replyLength)
+                continue;
+            if(replyLength) memcpy(reply, &_frame[3], replyLength);
+            return true;
+        }
+        if(_fd < 0) return false;
+    }
+    _stats.timeouts++;
+
+    return false;
+}
+
+bool Si4735LinkClient::receive(int timeout){
+    struct pollfd waiter;
+    unsigned long deadline;
+    Si4735_RX_Metrics RSQ;
+    word block[4];
+    byte value;
+    ssize_t count;
+    int left;
+
+    deadline = millis() + timeout;
+    waiter.fd = _fd;
+    waiter.events = POLLIN;
+    while(_fd >= 0) {
+        //Read whatever is there in one go; what follows a reply stays in
+        //_input for next time
+        if(_inputHead == _inputTail) {
+            left = (int)(deadline - millis());
+            if(left < 0) left = 0;
+            if(::poll(&waiter, 1, left) <= 0) return false;
+            count = ::read(_fd, _input, sizeof(_input));
+            if(count <= 0) {
+                close();
+                return false;
+            };
+            _inputHead = 0;
+            _inputTail = count;
+        };
+        value = _input[_inputHead++];
+        if(!_synced) {
+            _synced = (value == SI4735_LINK_SYNC);
+            _received = 0;
+            continue;
+        };
+        _frame[_received++] = value;
+        if(_received == 1 && value > SI4735_LINK_PAYLOAD) {
+            _synced = false;
+            _stats.crcErrors++;
+            continue;
+        };
+        if(_received < 3 || _received < 3 + _frame[0] + 2) continue;
+        _synced = false;
+        if(Si4735_crc16(_frame, 3 + _frame[0]) != 
+           word(_frame[3 + _frame[0]], _frame[3 + _frame[0] + 1])) {
+            _stats.crcErrors++;
+            continue;
+        };
+        _stats.framesReceived++;
+        if(_frame[2] == SI4735_LINK_RDS && _frame[0] == 9) {
+            _stats.events++;
+            for(byte i = 0; i < 4; i++)
+                block[i] = word(_frame[3 + i * 2], _frame[3 + i * 2 + 1]);
+            if(_onRDS) _onRDS(block, _frame[3 + 8]);
+        } else if(_frame[2] == SI4735_LINK_RSQ && _frame[0] == 6) {
+            _stats.events++;
+            RSQ.RSSI = _frame[3];
+            RSQ.SNR = _frame[4];
+            RSQ.MULT = _frame[5];
+            RSQ.FREQOFF = (signed char)_frame[6];
+            RSQ.STBLEND = _frame[7];
+            RSQ.PILOT = _frame[8];
+            if(_onRSQ) _onRSQ(&RSQ);
+        } else if(_frame[2] < SI4735_LINK_RDS) return true;
+    }
+
+    return false;
+}
+
+#if defined(__cpp_impl_coroutine)
+
+bool Si4735Awaiter::await_suspend(std::coroutine_handle<> handle){
+    _handle = handle;
+    if(_executor->add(this)) return true;
+
+    //No room to wait in, do it the old-fashioned way and carry on
+    while(!isReady()) delay(1);
+    return false;
+}
+
+bool Si4735RDSAwaiter::isReady(void){
+    //RDSINT only shows up in the status byte after GET_INT_STATUS
+    _tuner->sendCommand(SI4735_CMD_GET_INT_STATUS);
+
+    return _tuner->readRDSBlock(_block, _errors);
+}
+
+Si4735Executor::Si4735Executor(){
+    _waiting = 0;
+    _pollInterval = 10;
+    _fd = -1;
+    _polls = 0;
+    _resumes = 0;
+}
+
+Si4735SeekTuneAwaiter Si4735Executor::tune(Si4735* tuner, word frequency,
+                                           bool* valid){
+    tuner->startTune(frequency);
+
+    return Si4735SeekTuneAwaiter(this, tuner, valid);
+}
+
+Si4735SeekTuneAwaiter Si4735Executor::seek(Si4735* tuner, bool up, bool wrap,
+                                           bool* valid){
+    tuner->startSeek(up, wrap);
+
+    return Si4735SeekTuneAwaiter(this, tuner, valid);
+}
+
+Si4735RSQAwaiter Si4735Executor::getRSQ(Si4735* tuner,
+                                        Si4735_RX_Metrics* RSQ){
+    tuner->startRSQ();
+
+    return Si4735RSQAwaiter(this, tuner, RSQ);
+}
+
+Si4735RDSAwaiter Si4735Executor::nextRDSGroup(Si4735* tuner, word* block,
+                                              byte* errors){
+    return Si4735RDSAwaiter(this, tuner, block, errors);
+}
+
+bool Si4735Executor::add(Si4735Awaiter* awaiter){
+    if(_waiting == SI4735_EXECUTOR_WAITERS) return false;
+    _waiters[_waiting++] = awaiter;
+
+    return true;
+}
+
+bool Si4735Executor::runOnce(void){
+    struct pollfd event;
+    byte drain[64];
+    std::coroutine_handle<> handle;
+    byte i;
+
+    if(!_waiting) return false;
+    if(_fd >= 0) {
+        event.fd = _fd;
+        event.events = POLLIN | POLLPRI;
+        //A broken interrupt source leaves us polling, which still works
+        if(poll(&event, 1, _pollInterval) > 0 &&
+           read(_fd, drain, sizeof(drain)) < 0) _fd = -1;
+    } else delay(_pollInterval);
+    _polls++;
+
+    //Interrupts are shared and edges can be missed, so check everybody
+    i = 0;
+    while(i < _waiting) {
+        if(!_waiters[i]->isReady()) {
+            i++;
+            continue;
+        }
+        handle = _waiters[i]->_handle;
+        //Order doesn't matter, fill the hole with the last one. Whatever
+        //the resumed coroutine awaits next goes at the end.
+        _waiters[i] = _waiters[--_waiting];
+        _resumes++;
+        handle.resume();
+    }
+
+    return _waiting != 0;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,1224 @@
+/* Arduino Si4735 Library
+ * See the README file for author and licensing information. In case it's
+ * missing from your distribution, use the one here as the authoritative
+ * version: https://github.com/csdexter/Si4735/blob/master/README
+ *
+ * This library is for use with the SparkFun Si4735 Shield or Breakout Board.
+ * See the example sketches to learn how to use the library in your code.
+ *
+ * This file contains the facilities that are only available when building
+ * the library on a Linux host (i.e. with SI4735_LINUX defined).
+ */
+
+#ifndef _SI4735_LINUX_H_INCLUDED
+#define _SI4735_LINUX_H_INCLUDED
+
+#include "Si4735.h"
+
+#if defined(SI4735_LINUX)
+
+#include <pthread.h>
+#include <sys/types.h>
+
+//Define Si4735GPIO sizing, override before including to suit your wiring
+#if !defined(SI4735_GPIO_LINES)
+# define SI4735_GPIO_LINES 8
+#endif
+
+//Define Si4735BatchDecoder sizing: threads at most and groups per chunk, 
+//the unit its kernels work on (a few bytes of stack each)
+#if !defined(SI4735_BATCH_THREADS)
+# define SI4735_BATCH_THREADS 64
+#endif
+#if !defined(SI4735_BATCH_CHUNK)
+# define SI4735_BATCH_CHUNK 4096
+#endif
+
+//Define Si4735Daemon sizing, override before including to suit your rack.
+//SI4735_DAEMON_BACKLOG is per tuner and must be a power of 2.
+#if !defined(SI4735_DAEMON_TUNERS)
+# define SI4735_DAEMON_TUNERS 64
+#endif
+#if !defined(SI4735_DAEMON_BUSES)
+# define SI4735_DAEMON_BUSES 8
+#endif
+#if !defined(SI4735_DAEMON_WORKERS)
+# define SI4735_DAEMON_WORKERS 16
+#endif
+#if !defined(SI4735_DAEMON_BACKLOG)
+# define SI4735_DAEMON_BACKLOG 64
+#endif
+#if !defined(SI4735_DAEMON_BATCH)
+# define SI4735_DAEMON_BATCH 16
+#endif
+//The backlog indices run freely and wrap around, which only keeps landing
+//on the same slots for a power of 2
+static_assert(SI4735_DAEMON_BACKLOG && 
+              !(SI4735_DAEMON_BACKLOG & (SI4735_DAEMON_BACKLOG - 1)),
+              "SI4735_DAEMON_BACKLOG must be a power of 2");
+
+//Shared-memory snapshot magic and version, see Si4735Publisher
+#define SI4735_SHARED_MAGIC "S4SH"
+#define SI4735_SHARED_VERSION 3
+
+//List of Si4735Daemon thread types
+#define SI4735_DAEMON_IO 0
+#define SI4735_DAEMON_WORKER 1
+
+//This holds what Si4735Daemon knows about one tuner. Latencies are from the
+//RDS group leaving the chip to it being decoded, in microseconds.
+typedef struct {
+    //Frequency tuned to through Si4735Daemon::tune(), 0 if never
+    word frequency;
+    Si4735_RX_Metrics RSQ;
+    Si4735_RDS_Data rds;
+    bool haveTime;
+    Si4735_RDS_Time time;
+    //Groups decoded and groups dropped because the workers fell behind
+    unsigned long groups, dropped;
+    unsigned long latency, maxLatency;
+} Si4735_Daemon_Snapshot;
+
+//This holds the counters of one Si4735Daemon thread. Utilisation is 
+//busy / total.
+typedef struct {
+    //SI4735_DAEMON_IO or SI4735_DAEMON_WORKER
+    byte type;
+    //Bus or worker number
+    byte index;
+    //Groups drained off the chips (I/O threads) or decoded (workers)
+    unsigned long groups;
+    //Batches decoded for tuners homed on another worker
+    unsigned long steals;
+    //Time spent working and time since start(), in microseconds
+    unsigned long long busy, total;
+} Si4735_Daemon_Thread_Stats;
+
+//This is the header of the shared-memory region written by Si4735Publisher,
+//followed by one Si4735_Shared_Tuner every recordSize bytes. The layout is
+//that of the host, the region is only meant to be shared on it.
+typedef struct {
+    char magic[4];
+    uint8_t version;
+    uint8_t tuners;
+    uint16_t recordSize;
+    uint32_t reserved[3];
+} Si4735_Shared_Header;
+
+//This is the published state of one tuner.
+typedef struct {
+    //Odd while the publisher is writing, bumped on every change
+    uint32_t sequence;
+    //millis() of the last change; CLOCK_MONOTONIC is the same for every
+    //process on the host
+    uint32_t updated;
+    uint16_t frequency;
+    Si4735_RX_Metrics RSQ;
+    Si4735_RDS_Data rds;
+} Si4735_Shared_Tuner;
+
+//This is one station's worth of RDS groups laid out structure-of-arrays, 
+//as Si4735BatchDecoder takes them: block[n][i] is block n (A to D) of 
+//group i.
+typedef struct {
+    unsigned long count;
+    const uint16_t* block[4];
+    //Block error fields (see SI4735_RDS_BLE*) of each group, NULL if all
+    //blocks are good
+    const uint8_t* errors;
+} Si4735_RDS_Batch;
+
+//This holds the counters of one Si4735BatchDecoder thread. Throughput is
+//groups / busy.
+typedef struct {
+    unsigned long stations;
+    //Groups looked at and, of those, groups that had to go through the
+    //stateful decoder
+    unsigned long long groups, decoded;
+    //CPU time spent decoding, in microseconds
+    unsigned long long busy;
+} Si4735_Batch_Thread_Stats;
+
+//This holds the system calls the Linux transports and Si4735GPIO go 
+//through; the defaults (Si4735_syscalls) are the real ones, point them 
+//elsewhere to run against an in-process fake device.
+typedef struct {
+    int (*open)(const char* path, int flags);
+    int (*close)(int fd);
+    int (*ioctl)(int fd, unsigned long request, void* arg);
+    ssize_t (*read)(int fd, void* buffer, size_t size);
+} Si4735_Syscall_Ops;
+
+extern const Si4735_Syscall_Ops Si4735_syscalls;
+
+//This holds the counters of a Si4735LinuxTransport: commands written, 
+//status/response reads, system calls made and failed, respectively.
+typedef struct {
+    unsigned long writes;
+    unsigned long reads;
+    unsigned long syscalls;
+    unsigned long errors;
+} Si4735_Transport_Stats;
+
+//This holds the counters of a Si4735LinkClient: frames sent and received,
+//frames dropped for a bad CRC or length, requests sent again, requests that
+//ran out of retries and events (RDS/RSQ) received, respectively.
+typedef struct {
+    unsigned long framesSent;
+    unsigned long framesReceived;
+    unsigned long crcErrors;
+    unsigned long retries;
+    unsigned long timeouts;
+    unsigned long events;
+} Si4735_Link_Stats;
+
+class Si4735RDSReplayer
+{
+    public:
+        /*
+        * Description:
+        *   Default constructor.
+        */
+        Si4735RDSReplayer() { _map = NULL; _size = 0; }
+
+        /*
+        * Description:
+        *   This is the destructor, it unmaps the capture if still open.
+        */
+        ~Si4735RDSReplayer() { close(); }
+
+        /*
+        * Description:
+        *   Memory-maps the RDS capture file at path, as written by
+        *   Si4735RDSRecorder, and validates its header. Returns false if the
+        *   file can't be mapped or isn't a capture we understand.
+        */
+        bool open(const char* path);
+
+        /*
+        * Description:
+        *   Unmaps the capture.
+        */
+        void close(void);
+
+        /*
+        * Description:
+        *   Fills header with the header of the open capture, returning 
+        *   false if none is open. The file is little-endian whatever the 
+        *   host is, so this is a decoded copy rather than the file itself.
+        */
+        bool getHeader(Si4735_Capture_Header* header);
+
+        /*
+        * Description:
+        *   Returns the number of records in the open capture.
+        */
+        unsigned long getRecordCount(void);
+
+        /*
+        * Description:
+        *   Fills record with record number index of the open capture, 
+        *   decoded like getHeader() does, returning false if out of range.
+        */
+        bool getRecord(unsigned long index, Si4735_Capture_Record* record);
+
+        /*
+        * Description:
+        *   Feeds every record of the open capture to decoder, returning the
+        *   number of groups fed.
+        * Parameters:
+        *   decoder    - the decoder to feed.
+        *   realtime   - pace the groups by their timestamps, as received;
+        *                otherwise go as fast as possible.
+        *   skipErrors - do not feed groups with uncorrectable blocks (same
+        *                as the chip does with BLETH set to
+        *                SI4735_FLG_BLETH*_35, see enableRDS()).
+        */
+        unsigned long replay(Si4735RDSDecoder& decoder, bool realtime = false,
+                             bool skipErrors = true);
+
+    private:
+        const byte* _map;
+        size_t _size;
+};
+
+//Decodes RDS archives in bulk (link with -pthread): any number of stations,
+//each a Si4735_RDS_Batch or a capture, decoded on as many threads as asked,
+//a station per thread at a time, largest first. Within a station, groups 
+//are screened for errors and classified by type a chunk at a time. Every
+//group overwrites PI, TP and PTY, so only the last good one matters for 
+//those; the rest go through a Si4735RDSDecoder only if they carry more. The
+//outcome is the same as streaming every group through one (bar the 
+//SI4735_DEBUG statistics).
+class Si4735BatchDecoder
+{
+    public:
+        /*
+        * Description:
+        *   Default constructor.
+        */
+        Si4735BatchDecoder();
+
+        /*
+        * Description:
+        *   This is the destructor, it frees the stations.
+        */
+        ~Si4735BatchDecoder() { clear(); };
+
+        /*
+        * Description:
+        *   Adds a station whose groups are in batch, which is used in place
+        *   and must stay around until run() is done. Returns the station
+        *   number, -1 if out of memory.
+        */
+        int addStation(const Si4735_RDS_Batch* batch);
+
+        /*
+        * Description:
+        *   Adds a station whose groups are in the capture open in replayer,
+        *   copied into structure-of-arrays form. Returns the station 
+        *   number, -1 if out of memory or nothing is open.
+        */
+        int addCapture(Si4735RDSReplayer& replayer);
+
+        /*
+        * Description:
+        *   Forgets all stations.
+        */
+        void clear(void);
+
+        /*
+        * Description:
+        *   Decodes every station from scratch on threads threads.
+        * Parameters:
+        *   threads    - how many threads to run, at most 
+        *                SI4735_BATCH_THREADS.
+        *   skipErrors - do not decode groups with uncorrectable blocks, see
+        *                Si4735RDSReplayer::replay().
+        */
+        bool run(byte threads, bool skipErrors = true);
+
+        /*
+        * Description:
+        *   Returns the number of stations added.
+        */
+        unsigned int getStationCount(void) { return _stationCount; };
+
+        /*
+        * Description:
+        *   Returns the decoder holding what run() made of station, NULL if
+        *   there's no such station.
+        */
+        Si4735RDSDecoder* getDecoder(unsigned int station);
+
+        /*
+        * Description:
+        *   Fills stats with the counters of thread number thread of the
+        *   last run(). Returns false if there was no such thread.
+        */
+        bool getThreadStats(byte thread, Si4735_Batch_Thread_Stats* stats);
+
+        /*
+        * Description:
+        *   Returns the throughput of the last run(), in groups per second 
+        *   per core (i.e. per busy thread).
+        */
+        unsigned long getRate(void);
+
+    private:
+        struct Station {
+            Si4735_RDS_Batch batch;
+            //Arrays behind batch if we made them, NULL otherwise
+            void* owned;
+            //Not in the array itself, which realloc() moves around
+            Si4735RDSDecoder* decoder;
+        };
+        struct Thread {
+            Si4735BatchDecoder* decoder;
+            pthread_t thread;
+            Si4735_Batch_Thread_Stats stats;
+        };
+
+        Station* _stations;
+        unsigned int _stationCount, _next;
+        unsigned int* _order;
+        Thread _threads[SI4735_BATCH_THREADS];
+        byte _threadCount;
+        bool _skipErrors;
+
+        /*
+        * Description:
+        *   Grows _stations by one, returning the new one or NULL.
+        */
+        Station* newStation(void);
+
+        /*
+        * Description:
+        *   Thread body: takes stations off _order until there are none 
+        *   left.
+        */
+        static void* runThread(void* thread);
+
+        /*
+        * Description:
+        *   Decodes station from scratch, returning the number of groups 
+        *   that went through its decoder.
+        */
+        unsigned long decode(Station* station);
+};
+
+//Base of the transports below: owns the device file descriptor and counts
+//the system calls made on it.
+class Si4735LinuxTransport : public Si4735Transport
+{
+    public:
+        virtual ~Si4735LinuxTransport() { close(); };
+
+        /*
+        * Description:
+        *   Closes the device.
+        */
+        void close(void);
+
+        /*
+        * Description:
+        *   Returns true if the device is open.
+        */
+        bool isOpen(void) { return _fd >= 0; };
+
+        /*
+        * Description:
+        *   Fills stats with the counters kept since open() or resetStats().
+        *   syscalls / (writes + reads) is the cost of a bus operation.
+        */
+        void getStats(Si4735_Transport_Stats* stats) { *stats = _stats; };
+        void resetStats(void) {
+            memset((void *)&_stats, 0x00, sizeof(_stats));
+        };
+
+    protected:
+        const Si4735_Syscall_Ops* _ops;
+        int _fd;
+        Si4735_Transport_Stats _stats;
+
+        Si4735LinuxTransport(const Si4735_Syscall_Ops* ops);
+
+        /*
+        * Description:
+        *   Opens path, counting the call; returns false on failure.
+        */
+        bool openDevice(const char* path);
+
+        /*
+        * Description:
+        *   ioctl() on the device, counting the call; returns false on 
+        *   failure.
+        */
+        bool control(unsigned long request, void* arg);
+};
+
+class Si4735I2CDev : public Si4735LinuxTransport
+{
+    public:
+        /*
+        * Description:
+        *   Constructor, ops defaults to Si4735_syscalls.
+        */
+        Si4735I2CDev(const Si4735_Syscall_Ops* ops = NULL) :
+            Si4735LinuxTransport(ops) {};
+
+        /*
+        * Description:
+        *   Opens the I2C adapter at path (e.g. /dev/i2c-1) to talk to the
+        *   chip at address (0x11 with SEN low, 0x63 with SEN high).
+        */
+        bool open(const char* path, byte address);
+
+        void write(const byte* command);
+        void read(byte* response, byte length);
+
+        /*
+        * Description:
+        *   Writes command and reads the status byte back with a repeated
+        *   start, in one I2C_RDWR ioctl().
+        */
+        byte writeRead(const byte* command);
+
+    private:
+        byte _address;
+};
+
+class Si4735SPIDev : public Si4735LinuxTransport
+{
+    public:
+        /*
+        * Description:
+        *   Constructor, ops defaults to Si4735_syscalls.
+        */
+        Si4735SPIDev(const Si4735_Syscall_Ops* ops = NULL) :
+            Si4735LinuxTransport(ops) {};
+
+        /*
+        * Description:
+        *   Opens the SPI device at path (e.g. /dev/spidev0.0), whose chip
+        *   select must be wired to SEN, and sets it up for the chip: mode 0,
+        *   MSB first, at most speed Hz (2.5MHz is the chip's limit). The 
+        *   status and response are read on GPO1, as on the Shield.
+        */
+        bool open(const char* path, unsigned long speed = 2000000);
+
+        void write(const byte* command);
+        void read(byte* response, byte length);
+
+        /*
+        * Description:
+        *   Writes command and reads the status byte back, with SEN raised in
+        *   between, in one SPI_IOC_MESSAGE ioctl().
+        */
+        byte writeRead(const byte* command);
+
+    private:
+        unsigned long _speed;
+};
+
+//Pin access through the GPIO character device (/dev/gpiochipN). Pin numbers
+//as given to the Si4735 constructor are mapped to line offsets on the chip
+//with map(); pins that aren't mapped are ignored.
+class Si4735GPIO : public Si4735HostPins
+{
+    public:
+        /*
+        * Description:
+        *   Constructor, ops defaults to Si4735_syscalls.
+        */
+        Si4735GPIO(const Si4735_Syscall_Ops* ops = NULL);
+
+        /*
+        * Description:
+        *   This is the destructor, it releases all lines.
+        */
+        ~Si4735GPIO() { close(); };
+
+        /*
+        * Description:
+        *   Opens the GPIO chip at path and, unless another backend is set
+        *   already, makes this the one pin I/O goes to (Si4735_hostPins).
+        */
+        bool open(const char* path);
+
+        /*
+        * Description:
+        *   Releases all lines and the GPIO chip.
+        */
+        void close(void);
+
+        /*
+        * Description:
+        *   Maps pin to line of the GPIO chip, returning false if there's no
+        *   room left (see SI4735_GPIO_LINES).
+        */
+        bool map(byte pin, unsigned int line);
+
+        void pinMode(byte pin, byte mode);
+        void digitalWrite(byte pin, byte value);
+        int digitalRead(byte pin);
+
+        /*
+        * Description:
+        *   Turns pin into an input reporting falling edges and returns the
+        *   file descriptor to wait on (e.g. GPO2/INT, for 
+        *   Si4735Executor::setInterruptFd()), or -1 on failure.
+        */
+        int requestEvents(byte pin);
+
+        /*
+        * Description:
+        *   Returns the number of system calls made since construction.
+        */
+        unsigned long getSyscalls(void) { return _syscalls; };
+
+    private:
+        typedef struct {
+            byte pin;
+            unsigned int line;
+            int fd;
+        } Line;
+
+        const Si4735_Syscall_Ops* _ops;
+        Line _lines[SI4735_GPIO_LINES];
+        byte _count;
+        int _fd;
+        unsigned long _syscalls;
+
+        /*
+        * Description:
+        *   Returns the line pin is mapped to, or NULL.
+        */
+        Line* findLine(byte pin);
+
+        /*
+        * Description:
+        *   (Re)requests line from the kernel with flags (GPIO_V2_LINE_FLAG_*).
+        */
+        bool requestLine(Line* line, unsigned long long flags);
+};
+
+//Publishes the state of tuners into a POSIX shared-memory region (link with
+//-lrt on glibc older than 2.34), from where any number of Si4735Subscriber
+//in any process can take consistent snapshots without locks, system calls or
+//bus traffic. Each tuner is protected by a seqlock: the publisher makes the
+//sequence odd, writes only the fields that changed and makes it even again;
+//readers retry if the sequence was odd or moved while they copied.
+class Si4735Publisher
+{
+    public:
+        /*
+        * Description:
+        *   Default constructor.
+        */
+        Si4735Publisher();
+
+        /*
+        * Description:
+        *   This is the destructor, it unmaps the region.
+        */
+        ~Si4735Publisher() { close(); };
+
+        /*
+        * Description:
+        *   Creates (or takes over) the shared-memory object name (e.g. 
+        *   "/si4735") with room for tuners tuners, all blank. Returns false
+        *   if it can't be created, mapped or out of memory.
+        */
+        bool open(const char* name, byte tuners);
+
+        /*
+        * Description:
+        *   Unmaps the region and, if unlink is set, removes it.
+        */
+        void close(bool unlink = false);
+
+        /*
+        * Description:
+        *   Publishes the state of tuner. Any of frequency (0), RSQ and rds 
+        *   (NULL) can be left out to keep what was published before. Only 
+        *   fields that differ are written and nothing at all happens if none
+        *   do. Safe to call from several threads, writers of the same tuner
+        *   take turns.
+        */
+        void publish(byte tuner, word frequency, const Si4735_RX_Metrics* RSQ,
+                     const Si4735_RDS_Data* rds);
+
+        /*
+        * Description:
+        *   Returns the number of publish() calls that changed something and
+        *   of those that didn't, respectively.
+        */
+        unsigned long getPublished(void) { return _published; };
+        unsigned long getSkipped(void) { return _skipped; };
+
+    private:
+        byte* _map;
+        size_t _size;
+        char _name[32];
+        bool* _writing;
+        unsigned long _published, _skipped;
+};
+
+class Si4735Subscriber
+{
+    public:
+        /*
+        * Description:
+        *   Default constructor.
+        */
+        Si4735Subscriber() { _map = NULL; _size = 0; };
+
+        /*
+        * Description:
+        *   This is the destructor, it unmaps the region.
+        */
+        ~Si4735Subscriber() { close(); };
+
+        /*
+        * Description:
+        *   Maps the shared-memory object name read-only and validates it.
+        */
+        bool open(const char* name);
+
+        /*
+        * Description:
+        *   Unmaps the region.
+        */
+        void close(void);
+
+        /*
+        * Description:
+        *   Returns the number of tuners published.
+        */
+        byte getTunerCount(void) {
+            return _map ? ((const Si4735_Shared_Header *)_map)->tuners : 0;
+        };
+
+        /*
+        * Description:
+        *   Takes a consistent snapshot of tuner into snapshot, returning the
+        *   number of attempts it took, or 0 if there is no such tuner.
+        */
+        unsigned int read(byte tuner, Si4735_Shared_Tuner* snapshot);
+
+    private:
+        const byte* _map;
+        size_t _size;
+};
+
+//A receiver process running many tuners at once (link with -pthread). Each
+//bus gets an I/O thread, the only one talking to the tuners on it, which 
+//drains their RDS FIFOs into per-tuner backlogs. A pool of workers runs one
+//Si4735RDSDecoder per tuner off those: each worker looks after its own 
+//(home) tuners first and, once they're idle, steals batches from any other
+//tuner with a backlog, so a busy RT/TMC station doesn't hold up the rest.
+//Decoding results land in per-tuner snapshots.
+class Si4735Daemon
+{
+    public:
+        /*
+        * Description:
+        *   Default constructor.
+        */
+        Si4735Daemon();
+
+        /*
+        * Description:
+        *   This is the destructor, it stops the threads.
+        */
+        ~Si4735Daemon();
+
+        /*
+        * Description:
+        *   Adds a (begin()-ed) tuner sitting on bus and returns its index, 
+        *   or 0xFF if there's no room. Only before start().
+        * Parameters:
+        *   tuner - the tuner; tuners on the same physical bus (or sharing a
+        *           Si4735BusArbiter) must be given the same bus.
+        *   bus   - bus number, 0 to SI4735_DAEMON_BUSES - 1.
+        */
+        byte addTuner(Si4735* tuner, byte bus);
+
+        /*
+        * Description:
+        *   Starts one I/O thread per bus in use and workers decoder threads
+        *   (at most SI4735_DAEMON_WORKERS), returning false if any of them 
+        *   could not be started. Tuners must not be touched directly until 
+        *   stop(), use tune().
+        */
+        bool start(byte workers);
+
+        /*
+        * Description:
+        *   Stops and joins all threads.
+        */
+        void stop(void);
+
+        /*
+        * Description:
+        *   Has the I/O thread of tuner tune it to frequency, without waiting
+        *   for that to happen. The RDS state of the tuner is reset once the 
+        *   tune completed.
+        */
+        bool tune(byte tuner, word frequency);
+
+        /*
+        * Description:
+        *   Fills snapshot with the current state of tuner.
+        */
+        bool getSnapshot(byte tuner, Si4735_Daemon_Snapshot* snapshot);
+
+        /*
+        * Description:
+        *   Returns the number of threads started by the last start(), I/O
+        *   threads first; their stats stay available after stop().
+        */
+        byte getThreadCount(void) { return _threadCount; };
+
+        /*
+        * Description:
+        *   Fills stats with the counters of thread.
+        */
+        bool getThreadStats(byte thread, Si4735_Daemon_Thread_Stats* stats);
+
+        /*
+        * Description:
+        *   Sets how long, in ms, an I/O thread sleeps after a round of its
+        *   tuners that found nothing to do.
+        */
+        void setPollInterval(byte pollInterval) {
+            _pollInterval = pollInterval;
+        };
+
+        /*
+        * Description:
+        *   Sets how often, in ms, the I/O threads read the RSQ metrics of 
+        *   their tuners; 0 never does. A tuner that doesn't answer within 
+        *   the interval is left to its watchdog and, if that gives up on 
+        *   it, not talked to again until tune() is called for it, so that
+        *   the other tuners on the bus carry on.
+        */
+        void setRSQInterval(word rsqInterval) { _rsqInterval = rsqInterval; };
+
+        /*
+        * Description:
+        *   Has every snapshot change also published through publisher, 
+        *   whose tuners are numbered like ours. Call before start().
+        */
+        void setPublisher(Si4735Publisher* publisher) {
+            _publisher = publisher;
+        };
+
+    private:
+        typedef struct {
+            unsigned long timestamp;
+            word block[4];
+            byte generation;
+        } Group;
+
+        typedef struct {
+            Si4735* tuner;
+            byte bus, home;
+            //Backlog, filled by the I/O thread and emptied by whichever 
+            //worker holds claimed
+            Group backlog[SI4735_DAEMON_BACKLOG];
+            unsigned int head, tail;
+            bool claimed;
+            //Bumped on every completed tune, decoded is what the decoder
+            //and snapshot are on
+            byte generation, decoded;
+            word request;
+            bool tuning, rsqPending, stuck;
+            unsigned long rsqPolled;
+            Si4735RDSDecoder decoder;
+            pthread_mutex_t lock;
+            Si4735_Daemon_Snapshot snapshot;
+            unsigned long long latencySum;
+        } Station;
+
+        typedef struct {
+            Si4735Daemon* daemon;
+            pthread_t thread;
+            Si4735_Daemon_Thread_Stats stats;
+        } Thread;
+
+        Station _stations[SI4735_DAEMON_TUNERS];
+        Thread _threads[SI4735_DAEMON_BUSES + SI4735_DAEMON_WORKERS];
+        byte _stationCount, _threadCount, _workers, _pollInterval;
+        word _rsqInterval;
+        Si4735Publisher* _publisher;
+        bool _running;
+        pthread_mutex_t _lock;
+        pthread_cond_t _work;
+
+        static void* runIO(void* thread);
+        static void* runWorker(void* thread);
+
+        /*
+        * Description:
+        *   Body of the I/O thread of a bus.
+        */
+        void pollBus(Thread* thread);
+
+        /*
+        * Description:
+        *   Body of a worker thread.
+        */
+        void decode(Thread* thread);
+
+        /*
+        * Description:
+        *   Decodes up to SI4735_DAEMON_BATCH groups off the backlog of 
+        *   station, unless another worker is at it. Returns the number of
+        *   groups decoded.
+        */
+        unsigned int drain(Station* station, Thread* thread);
+
+        /*
+        * Description:
+        *   Returns true if station has groups waiting to be decoded.
+        */
+        bool isPending(Station* station);
+};
+
+//The host end of the Si4735Link protocol: drives a tuner hanging off an
+//Arduino (running Si4735Link) through a serial port, batching commands and
+//property accesses into CRC-checked frames and taking RDS groups and RSQ
+//samples as they are streamed back. Requests that get no good reply in time
+//are sent again with the same SEQ.
+class Si4735LinkClient
+{
+    public:
+        /*
+        * Description:
+        *   Default constructor.
+        */
+        Si4735LinkClient();
+
+        /*
+        * Description:
+        *   This is the destructor, it closes the port.
+        */
+        ~Si4735LinkClient() { close(); };
+
+        /*
+        * Description:
+        *   Opens the serial port at path (e.g. "/dev/ttyACM0") in raw mode at
+        *   baud bits per second. Any open file descriptor (pipe, pty, 
+        *   socket) can be handed over with setFd() instead.
+        */
+        bool open(const char* path, unsigned long baud = 115200);
+        void setFd(int fd) { close(); _fd = fd; };
+
+        /*
+        * Description:
+        *   Closes the port.
+        */
+        void close(void);
+
+        /*
+        * Description:
+        *   Runs count (at most 8) commands of 8 bytes each, back to back, in
+        *   a single round trip.
+        * Parameters:
+        *   commands - command and arguments, zero-padded, 8 bytes each.
+        *   statuses - if not NULL, receives the status byte of each command.
+        *   response - if not NULL, receives the 16-byte response of the 
+        *              last command.
+        */
+        bool sendCommands(const byte* commands, byte count, byte* statuses,
+                          byte* response = NULL);
+
+        /*
+        * Description:
+        *   Reads count properties into values, as few frames as it takes.
+        */
+        bool getProperties(const word* properties, byte count, word* values);
+
+        /*
+        * Description:
+        *   Writes count properties, as few frames as it takes.
+        */
+        bool setProperties(const word* properties, const word* values,
+                           byte count);
+
+        /*
+        * Description:
+        *   Selects what the device streams back: SI4735_LINK_STREAM_* OR-ed
+        *   together, RSQ every interval ms.
+        */
+        bool setStreams(byte streams, word interval = 1000);
+
+        /*
+        * Description:
+        *   Sets the functions to be called for each RDS group (blocks A to
+        *   D and the block error fields) and each RSQ sample received. They
+        *   are called from poll() and from within the requests above.
+        */
+        void setRDSCallback(void (*callback)(const word* block, byte errors)) {
+            _onRDS = callback;
+        };
+        void setRSQCallback(void (*callback)(const Si4735_RX_Metrics* RSQ)) {
+            _onRSQ = callback;
+        };
+
+        /*
+        * Description:
+        *   Waits up to timeout ms for events and dispatches them. Returns 
+        *   false if the port failed.
+        */
+        bool poll(int timeout);
+
+        /*
+        * Description:
+        *   Sets how long (ms) to wait for a reply and how many times to send
+        *   a request again before giving up.
+        */
+        void setTimeout(int timeout) { _timeout = timeout; };
+        void setRetries(byte retries) { _retries = retries; };
+
+        /*
+        * Description:
+        *   Returns the link counters.
+        */
+        const Si4735_Link_Stats* getStats(void) { return &_stats; };
+
+    private:
+        int _fd;
+        int _timeout;
+        byte _retries, _seq;
+        //LEN, SEQ, TYPE, payload, CRC of the frame being received
+        byte _frame[3 + SI4735_LINK_PAYLOAD + 2];
+        byte _received;
+        bool _synced;
+        //Bytes read off the port and not parsed yet, from _inputHead on
+        byte _input[256];
+        int _inputHead, _inputTail;
+        void (*_onRDS)(const word* block, byte errors);
+        void (*_onRSQ)(const Si4735_RX_Metrics* RSQ);
+        Si4735_Link_Stats _stats;
+
+        /*
+        * Description:
+        *   Sends a request and waits for its reply, copying its payload into
+        *   reply (the first length bytes). Returns false on a NAK, or if no
+        *   reply came even after retrying.
+        */
+        bool transact(byte type, const byte* payload, byte length, 
+                      byte* reply, byte replyLength);
+
+        /*
+        * Description:
+        *   Waits up to timeout ms for a frame, dispatching events as they
+        *   come; returns true with _frame holding the first reply, false on
+        *   timeout or error.
+        */
+        bool receive(int timeout);
+};
+
+//The coroutine front-end needs a C++20 compiler (e.g. g++ -std=c++20)
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+
+//Define Si4735Executor sizing, override before including to suit your setup
+#if !defined(SI4735_EXECUTOR_WAITERS)
+# define SI4735_EXECUTOR_WAITERS 16
+#endif
+
+//This is the return type of coroutines driving tuners, e.g.:
+//  Si4735Task scan(Si4735Executor& executor, Si4735& radio) {
+//      word frequency = co_await executor.seek(&radio, true);
+//      ...
+//  }
+//The coroutine starts running straight away, up to its first co_await. The
+//Si4735Task must outlive the coroutine (check isDone()), as destroying it
+//destroys the coroutine.
+class Si4735Task
+{
+    public:
+        struct promise_type {
+            Si4735Task get_return_object(void) {
+                return Si4735Task(
+                    std::coroutine_handle<promise_type>::from_promise(*this));
+            };
+            std::suspend_never initial_suspend(void) noexcept { return {}; };
+            std::suspend_always final_suspend(void) noexcept { return {}; };
+            void return_void(void) {};
+            //The library doesn't use exceptions
+            void unhandled_exception(void) { abort(); };
+        };
+
+        Si4735Task(Si4735Task&& other) : _handle(other._handle) {
+            other._handle = NULL;
+        };
+        ~Si4735Task() { if(_handle) _handle.destroy(); };
+
+        /*
+        * Description:
+        *   Returns true once the coroutine has returned.
+        */
+        bool isDone(void) { return !_handle || _handle.done(); };
+
+    private:
+        std::coroutine_handle<promise_type> _handle;
+
+        Si4735Task(std::coroutine_handle<promise_type> handle) :
+            _handle(handle) {};
+        Si4735Task(const Si4735Task&) = delete;
+};
+
+class Si4735Executor;
+
+//Base of the awaitables handed out by Si4735Executor. Only one coroutine may
+//be waiting on a given tuner at any time.
+class Si4735Awaiter
+{
+    public:
+        bool await_ready(void) { return isReady(); };
+        bool await_suspend(std::coroutine_handle<> handle);
+
+    protected:
+        Si4735Executor* _executor;
+        Si4735* _tuner;
+
+        Si4735Awaiter(Si4735Executor* executor, Si4735* tuner) :
+            _executor(executor), _tuner(tuner) {};
+        virtual ~Si4735Awaiter() {};
+
+        /*
+        * Description:
+        *   Checks (without waiting) whether what is being awaited happened.
+        */
+        virtual bool isReady(void) = 0;
+
+    private:
+        std::coroutine_handle<> _handle;
+
+        friend class Si4735Executor;
+};
+
+//Awaits STC, returns the frequency tuned to
+class Si4735SeekTuneAwaiter : public Si4735Awaiter
+{
+    public:
+        Si4735SeekTuneAwaiter(Si4735Executor* executor, Si4735* tuner,
+                              bool* valid) :
+            Si4735Awaiter(executor, tuner), _valid(valid) {};
+        word await_resume(void) { return _tuner->getFrequency(_valid); };
+
+    protected:
+        bool isReady(void) { return _tuner->isSeekTuneComplete(); };
+
+    private:
+        bool* _valid;
+};
+
+//Awaits the response to RSQ_STATUS
+class Si4735RSQAwaiter : public Si4735Awaiter
+{
+    public:
+        Si4735RSQAwaiter(Si4735Executor* executor, Si4735* tuner,
+                         Si4735_RX_Metrics* RSQ) :
+            Si4735Awaiter(executor, tuner), _RSQ(RSQ) {};
+        void await_resume(void) {};
+
+    protected:
+        bool isReady(void) { return _tuner->isRSQReady(_RSQ); };
+
+    private:
+        Si4735_RX_Metrics* _RSQ;
+};
+
+//Awaits the next RDS group
+class Si4735RDSAwaiter : public Si4735Awaiter
+{
+    public:
+        Si4735RDSAwaiter(Si4735Executor* executor, Si4735* tuner,
+                         word* block, byte* errors) :
+            Si4735Awaiter(executor, tuner), _block(block), _errors(errors) {};
+        void await_resume(void) {};
+
+    protected:
+        bool isReady(void);
+
+    private:
+        word* _block;
+        byte* _errors;
+};
+
+class Si4735Executor
+{
+    public:
+        /*
+        * Description:
+        *   Default constructor.
+        */
+        Si4735Executor();
+
+        /*
+        * Description:
+        *   Starts tuning tuner to frequency; co_await the result to get the
+        *   frequency once the tune completed.
+        * Parameters:
+        *   valid - if not NULL, receives whether the station is valid, see
+        *           Si4735::getFrequency().
+        */
+        Si4735SeekTuneAwaiter tune(Si4735* tuner, word frequency,
+                                   bool* valid = NULL);
+
+        /*
+        * Description:
+        *   Starts a seek on tuner, see Si4735::startSeek(); co_await the 
+        *   result to get the frequency the seek stopped at.
+        */
+        Si4735SeekTuneAwaiter seek(Si4735* tuner, bool up, bool wrap = true,
+                                   bool* valid = NULL);
+
+        /*
+        * Description:
+        *   Asks tuner for its RSQ metrics; co_await the result to have them
+        *   in RSQ.
+        */
+        Si4735RSQAwaiter getRSQ(Si4735* tuner, Si4735_RX_Metrics* RSQ);
+
+        /*
+        * Description:
+        *   co_await the result to have the next RDS group tuner receives in
+        *   block (and errors), see Si4735::readRDSBlock().
+        */
+        Si4735RDSAwaiter nextRDSGroup(Si4735* tuner, word* block,
+                                      byte* errors = NULL);
+
+        /*
+        * Description:
+        *   Sets a file descriptor that becomes readable when (any of) the
+        *   tuners pull GPO2/INT low, e.g. a GPIO line event fd; it gets 
+        *   drained with read(). Pass -1 to go back to plain polling.
+        */
+        void setInterruptFd(int fd) { _fd = fd; };
+
+        /*
+        * Description:
+        *   Sets the longest time, in ms, runOnce() waits for the interrupt
+        *   or, without one, sleeps between polls.
+        */
+        void setPollInterval(byte pollInterval) {
+            _pollInterval = pollInterval;
+        };
+
+        /*
+        * Description:
+        *   Waits for the interrupt (or the poll interval), then resumes
+        *   every coroutine whose wait is over. Returns true while any 
+        *   coroutine is still waiting. Call from your event loop or use 
+        *   run().
+        */
+        bool runOnce(void);
+
+        /*
+        * Description:
+        *   Calls runOnce() until no coroutine is waiting any more.
+        */
+        void run(void) { while(runOnce()); };
+
+        /*
+        * Description:
+        *   Returns the number of coroutines waiting.
+        */
+        byte getWaiting(void) { return _waiting; };
+
+        /*
+        * Description:
+        *   Returns the number of poll rounds and of coroutine resumptions,
+        *   respectively, since construction.
+        */
+        unsigned long getPolls(void) { return _polls; };
+        unsigned long getResumes(void) { return _resumes; };
+
+    private:
+        Si4735Awaiter* _waiters[SI4735_EXECUTOR_WAITERS];
+        byte _waiting, _pollInterval;
+        int _fd;
+        unsigned long _polls, _resumes;
+
+        /*
+        * Description:
+        *   Registers awaiter to be checked on every poll, returning false 
+        *   if SI4735_EXECUTOR_WAITERS coroutines are waiting already.
+        */
+        bool add(Si4735Awaiter* awaiter);
+
+        friend class Si4735Awaiter;
+};
+
+#endif
+
+#endif
+
+#endif
@@ -41,6 +41,13 @@
 #define SI4735_RDS_PTYNAB word(0x0010)
 #define SI4735_RDS_PTYN_ADDRESS word(0x0001)
 
+//Define RDS slow labelling codes (group 1A block C) decoding masks
+#define SI4735_RDS_SLC_VARIANT_MASK word(0x7000)
+#define SI4735_RDS_SLC_VARIANT_SHR 12
+#define SI4735_RDS_SLC_DATA_MASK word(0x00FF)
+#define SI4735_RDS_SLC_ECC 0
+#define SI4735_RDS_SLC_LANGUAGE 3
+
 //Define RDS CT (group 4A) decoding masks
 #define SI4735_RDS_TIME_TZ_OFFSET 0x0000001FUL
 #define SI4735_RDS_TIME_TZ_SIGN 0x00000020UL
@@ -85,4 +92,16 @@
 #define SI4735_GROUP_15A 0x1E
 #define SI4735_GROUP_15B 0x1F
 
+//Define which group types Si4735RDSDecoder::decodeRDSBlock() gets anything
+//out of besides PI, TP and PTY, one bit per SI4735_GROUP_*; keep in sync
+#define SI4735_GROUPS_STATEFUL ((1UL << SI4735_GROUP_0A) | \
+                                (1UL << SI4735_GROUP_0B) | \
+                                (1UL << SI4735_GROUP_1A) | \
+                                (1UL << SI4735_GROUP_1B) | \
+                                (1UL << SI4735_GROUP_2A) | \
+                                (1UL << SI4735_GROUP_2B) | \
+                                (1UL << SI4735_GROUP_4A) | \
+                                (1UL << SI4735_GROUP_10A) | \
+                                (1UL << SI4735_GROUP_15B))
+
 #endif
@@ -20,6 +20,16 @@
 # include <Wire.h>
 #endif
 
+word Si4735_crc16(const byte* data, word length, word crc){
+    while(length--) {
+        crc ^= (word)*data++ << 8;
+        for(byte i = 0; i < 8; i++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+
+    return crc;
+}
+
 void Si4735RDSDecoder::decodeRDSBlock(word block[]){
     byte grouptype;
     word fourchars[2];
@@ -46,22 +56,38 @@ void Si4735RDSDecoder::decodeRDSBlock(word block[]){
             DIPSA = lowByte(block[1] & SI4735_RDS_DIPS_ADDRESS);
             bitWrite(_status.DICC, 3 - DIPSA, block[1] & SI4735_RDS_DI);
             twochars = switchEndian(block[3]);
-            strncpy(&_status.programService[DIPSA * 2], (char *)&twochars, 2);
+            updateText(_ps, 8, DIPSA * 2, (char *)&twochars, 2, 
+                       _status.programService);
             if(grouptype == SI4735_GROUP_0A) {
                 //TODO: read the standard and do AF list decoding
             }
             break;
         case SI4735_GROUP_1A:
+            //Slow labelling codes, only the variants we have use for
+            switch((block[2] & SI4735_RDS_SLC_VARIANT_MASK) >>
+                   SI4735_RDS_SLC_VARIANT_SHR) {
+                case SI4735_RDS_SLC_ECC:
+                    _status.ECC = lowByte(block[2] & SI4735_RDS_SLC_DATA_MASK);
+                    break;
+                case SI4735_RDS_SLC_LANGUAGE:
+                    _status.LIC = lowByte(block[2] & SI4735_RDS_SLC_DATA_MASK);
+                    break;
+            }
+            //Both carry the PIN in block D
+            //Fall through
         case SI4735_GROUP_1B:
-            //TODO: read the standard and do PIN and slow labeling codes
+            _status.PIN = block[3];
             break;
         case SI4735_GROUP_2A:
         case SI4735_GROUP_2B:
             byte RTA, RTAW;
 
-            if((block[1] & SI4735_RDS_TEXTAB) != _rdstextab) {
+            if(bool(block[1] & SI4735_RDS_TEXTAB) != _rdstextab) {
                 _rdstextab = !_rdstextab;
-                memset(_status.radioText, ' ', 64);
+                memset(_rt, ' ', 64);
+                convertText(_rt, 64, _status.radioText);
+                _rtsegments = 0;
+                _rtcomplete = false;
             }
             RTA = lowByte(block[1] & SI4735_RDS_TEXT_ADDRESS);
             RTAW = (grouptype == SI4735_GROUP_2A) ? 4 : 2;
@@ -69,7 +95,15 @@ void Si4735RDSDecoder::decodeRDSBlock(word block[]){
                 block[(grouptype == SI4735_GROUP_2A) ? 2 : 3]);
             if(grouptype == SI4735_GROUP_2A) 
                 fourchars[1] = switchEndian(block[3]);
-            strncpy(&_status.radioText[RTA * RTAW], (char *)fourchars, RTAW);
+            //A segment we have coming back different is a new message (or 
+            //noise) even though A/B stayed put, start counting over
+            if(updateText(_rt, 64, RTA * RTAW, (char *)fourchars, RTAW, 
+                          _status.radioText) && bitRead(_rtsegments, RTA)) {
+                _rtsegments = 0;
+                _rtcomplete = false;
+            }
+            bitSet(_rtsegments, RTA);
+            checkRadioText(RTAW);
             break;
         case SI4735_GROUP_3A:
             //TODO: read the standard and do AID listing
@@ -104,7 +138,9 @@ void Si4735RDSDecoder::decodeRDSBlock(word block[]){
                   SI4735_RDS_MJD_SHL;
             MJD |= (CT & SI4735_RDS_TIME_MJD_MASK) >> SI4735_RDS_TIME_MJD_SHR;
 
-            //We report UTC for now, better not fiddle with timezones
+            //We report UTC, along with the offset to local time
+            _time.tm_offset = (CT & SI4735_RDS_TIME_TZ_OFFSET) * 30;
+            if(CT & SI4735_RDS_TIME_TZ_SIGN) _time.tm_offset *= -1;
             _time.tm_hour = (CT & SI4735_RDS_TIME_HOUR_MASK) >>
                                           SI4735_RDS_TIME_HOUR_SHR;
             _time.tm_min = (CT & SI4735_RDS_TIME_MINUTE_MASK) >>
@@ -135,13 +171,12 @@ void Si4735RDSDecoder::decodeRDSBlock(word block[]){
         case SI4735_GROUP_10A:
             if((block[1] & SI4735_RDS_PTYNAB) != _rdsptynab) {
                 _rdsptynab = !_rdsptynab;
-                memset(_status.programTypeName, ' ', 8);
+                memset(_ptyn, ' ', 8);
             }
             fourchars[0] = switchEndian(block[2]);
             fourchars[1] = switchEndian(block[3]);
-            strncpy(&_status.programTypeName[(block[1] & 
-                                              SI4735_RDS_PTYN_ADDRESS) * 4], 
-                    (char *)&fourchars, 4);            
+            updateText(_ptyn, 8, (block[1] & SI4735_RDS_PTYN_ADDRESS) * 4, 
+                       (char *)fourchars, 4, _status.programTypeName);
             break;
         case SI4735_GROUP_13A:
             //TODO: read the standard and do Enhanced Radio Paging
@@ -157,10 +192,6 @@ void Si4735RDSDecoder::decodeRDSBlock(word block[]){
 }
 
 void Si4735RDSDecoder::getRDSData(Si4735_RDS_Data* rdsdata){
-    makePrintable(_status.programService);
-    makePrintable(_status.programTypeName);
-    makePrintable(_status.radioText);
-
     *rdsdata = _status;
 }
 
@@ -170,30 +201,265 @@ bool Si4735RDSDecoder::getRDSTime(Si4735_RDS_Time* rdstime){
     return _havect;
 }
 
+bool Si4735RDSDecoder::setCharset(byte charset){
+    if(charset > SI4735_RDS_CHARSET_UTF8 || 
+       (charset == SI4735_RDS_CHARSET_UTF8 && SI4735_RDS_CHAR_BYTES < 3))
+        return false;
+
+    _charset = charset;
+    convertText(_ps, 8, _status.programService);
+    convertText(_ptyn, 8, _status.programTypeName);
+    convertText(_rt, 64, _status.radioText);
+
+    return true;
+}
+
 void Si4735RDSDecoder::resetRDS(void){
-    memset(_status.programService, ' ', 8);
-    _status.programService[8] = '\0';
-    memset(_status.programTypeName, ' ', 8);
-    _status.programTypeName[8] = '\0';
-    memset(_status.radioText, ' ', 64);
-    _status.radioText[64] = '\0';    
+    memset(_ps, ' ', 8);
+    memset(_ptyn, ' ', 8);
+    memset(_rt, ' ', 64);
+    convertText(_ps, 8, _status.programService);
+    convertText(_ptyn, 8, _status.programTypeName);
+    convertText(_rt, 64, _status.radioText);
     _status.DICC = 0;
+    _status.ECC = 0;
+    _status.LIC = 0;
+    _status.PIN = 0;
     _rdstextab = false;
     _rdsptynab = false;
     _havect = false;
+    _rtsegments = 0;
+    _rtcomplete = false;
+    _rthash = 0;
 #if defined(SI4735_DEBUG)
     memset((void *)&_rdsstats, 0x00, sizeof(_rdsstats));
 #endif
 }
 
-void Si4735RDSDecoder::makePrintable(char* str){
-    for(byte i = 0; i < strlen(str); i++) {
-        if(str[i] == 0x0D) {
-            str[i] = '\0';
+void Si4735RDSDecoder::getIdentity(Si4735_Snapshot* snapshot){
+    snapshot->PI = _status.programIdentifier;
+    snapshot->PTY = _status.PTY;
+    //Keep it as received, it's converted again on the way back in
+    memcpy(snapshot->programService, _ps, 8);
+    snapshot->programService[8] = '\0';
+}
+
+void Si4735RDSDecoder::setIdentity(const Si4735_Snapshot* snapshot){
+    _status.programIdentifier = snapshot->PI;
+    _status.PTY = snapshot->PTY;
+    memcpy(_ps, snapshot->programService, 8);
+    convertText(_ps, 8, _status.programService);
+}
+
+void Si4735RDSClock::reset(void){
+    _base = 0;
+    _stamp = 0;
+    _refBase = 0;
+    _refStamp = 0;
+    _updates = 0;
+    _jumps = 0;
+    _drift = 0;
+    _offset = 0;
+    _valid = false;
+}
+
+bool Si4735RDSClock::decodeRDSBlock(const word block[], unsigned long now){
+    unsigned long CT, MJD, UTC, expected, hostElapsed, ctElapsed;
+
+    if(lowByte((block[1] & SI4735_RDS_TYPE_MASK) >> SI4735_RDS_TYPE_SHR) !=
+       SI4735_GROUP_4A) return false;
+    CT = ((unsigned long)block[2] << 16) | block[3];
+    if(!CT) return false;
+
+    MJD = (unsigned long)(block[1] & SI4735_RDS_MJD_MASK) << SI4735_RDS_MJD_SHL;
+    MJD |= (CT & SI4735_RDS_TIME_MJD_MASK) >> SI4735_RDS_TIME_MJD_SHR;
+    //MJD 40587 is 1970-01-01; anything before is garbage
+    if(MJD < 40587) return false;
+    UTC = (MJD - 40587) * 86400UL + 
+          ((CT & SI4735_RDS_TIME_HOUR_MASK) >> SI4735_RDS_TIME_HOUR_SHR) * 
+          3600UL +
+          ((CT & SI4735_RDS_TIME_MINUTE_MASK) >> SI4735_RDS_TIME_MINUTE_SHR) *
+          60UL;
+
+    _updates++;
+    if(_valid) {
+        expected = getUTC(now);
+        if((UTC > expected ? UTC - expected : expected - UTC) > 90) {
+            _jumps++;
+            _valid = false;
+        };
+    };
+    if(!_valid) {
+        //Start a new run, keeping whatever drift we knew: it's ours
+        _refBase = UTC;
+        _refStamp = now;
+        _valid = true;
+    } else {
+        hostElapsed = now - _refStamp;
+        ctElapsed = (UTC - _refBase) * 1000UL;
+        if(ctElapsed >= SI4735_RDS_CLOCK_BASELINE)
+            _drift = ((long long)hostElapsed - (long long)ctElapsed) * 
+                     1000000LL / ctElapsed;
+    };
+    _base = UTC;
+    _stamp = now;
+    _offset = (CT & SI4735_RDS_TIME_TZ_OFFSET) * 30;
+    if(CT & SI4735_RDS_TIME_TZ_SIGN) _offset *= -1;
+
+    return true;
+}
+
+unsigned long Si4735RDSClock::getUTC(void){
+    return (_valid ? getUTC(millis()) : 0);
+}
+
+unsigned long Si4735RDSClock::getUTC(unsigned long now){
+    unsigned long elapsed;
+
+    elapsed = now - _stamp;
+    //Take out what millis() gained or lost since
+    elapsed -= (long long)elapsed * _drift / 1000000LL;
+
+    return _base + elapsed / 1000;
+}
+
+bool Si4735RDSClock::getTime(Si4735_RDS_Time* time, byte* second, bool local){
+    unsigned long now, days, z, era, doe, yoe, doy, mp;
+
+    if(!_valid) return false;
+    now = (local ? getLocal() : getUTC());
+    days = now / 86400UL;
+    if(second) *second = now % 60;
+    time->tm_min = (now / 60) % 60;
+    time->tm_hour = (now / 3600) % 24;
+    //1970-01-01 was a Thursday, weeks start on Monday (1) like RDS's
+    time->tm_wday = (days + 3) % 7 + 1;
+    //Civil from days, see http://howardhinnant.github.io/date_algorithms.html
+    z = days + 719468UL;
+    era = z / 146097UL;
+    doe = z - era * 146097UL;
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+    time->tm_mday = doy - (153 * mp + 2) / 5 + 1;
+    time->tm_mon = (mp < 10) ? mp + 3 : mp - 9;
+    time->tm_year = yoe + era * 400 + (time->tm_mon <= 2 ? 1 : 0);
+    time->tm_offset = (local ? 0 : _offset);
+
+    return true;
+}
+
+//EBU Latin (IEC 62106 Annex E) 0x80-0xFF to Unicode and to the nearest
+//ASCII, respectively. Below 0x80 it's ASCII save for the four characters 
+//handled in convertText().
+const word Si4735_EBU2Unicode[128] PROGMEM = {
+    0x00E1, 0x00E0, 0x00E9, 0x00E8, 0x00ED, 0x00EC, 0x00F3, 0x00F2,
+    0x00FA, 0x00F9, 0x00D1, 0x00C7, 0x015E, 0x00DF, 0x00A1, 0x0132,
+    0x00E2, 0x00E4, 0x00EA, 0x00EB, 0x00EE, 0x00EF, 0x00F4, 0x00F6,
+    0x00FB, 0x00FC, 0x00F1, 0x00E7, 0x015F, 0x011F, 0x0131, 0x0133,
+    0x00AA, 0x03B1, 0x00A9, 0x2030, 0x011E, 0x011B, 0x0148, 0x0151,
+    0x03C0, 0x20AC, 0x00A3, 0x0024, 0x2190, 0x2191, 0x2192, 0x2193,
+    0x00BA, 0x00B9, 0x00B2, 0x00B3, 0x00B1, 0x0130, 0x0144, 0x0171,
+    0x00B5, 0x00BF, 0x00F7, 0x00B0, 0x00BC, 0x00BD, 0x00BE, 0x00A7,
+    0x00C1, 0x00C0, 0x00C9, 0x00C8, 0x00CD, 0x00CC, 0x00D3, 0x00D2,
+    0x00DA, 0x00D9, 0x0158, 0x010C, 0x0160, 0x017D, 0x0110, 0x013F,
+    0x00C2, 0x00C4, 0x00CA, 0x00CB, 0x00CE, 0x00CF, 0x00D4, 0x00D6,
+    0x00DB, 0x00DC, 0x0159, 0x010D, 0x0161, 0x017E, 0x0111, 0x0140,
+    0x00C3, 0x00C5, 0x00C6, 0x0152, 0x0177, 0x00DD, 0x00D5, 0x00D8,
+    0x00DE, 0x014A, 0x0154, 0x0106, 0x015A, 0x0179, 0x0166, 0x00F0,
+    0x00E3, 0x00E5, 0x00E6, 0x0153, 0x0175, 0x00FD, 0x00F5, 0x00F8,
+    0x00FE, 0x014B, 0x0155, 0x0107, 0x015B, 0x017A, 0x0167, 0x0020};
+const char Si4735_EBU2ASCII[] PROGMEM = 
+    "aaeeiioouuNCSs!I" "aaeeiioouuncsgii" "aac%GenopEL$<^>v" 
+    "o123+Inuu?/o???S" "AAEEIIOOUURCSZDL" "AAEEIIOOUUrcszdl" 
+    "AAAOyYOOTNRCSZTd" "aaaowyootnrcszt ";
+
+bool Si4735RDSDecoder::updateText(char* raw, byte size, byte offset, 
+                                  const char* chars, byte length, 
+                                  char* text){
+    if(!memcmp(&raw[offset], chars, length)) return false;
+
+    memcpy(&raw[offset], chars, length);
+    convertText(raw, size, text);
+
+    return true;
+}
+
+void Si4735RDSDecoder::checkRadioText(byte width){
+    byte length;
+    word expected;
+    unsigned long hash;
+
+    if(_rtcomplete) return;
+
+    //The message ends at the first 0x0D in a segment we have, if any; a
+    //0x0D elsewhere is left over from an earlier message
+    length = 16 * width;
+    for(byte i = 0; i < 16 * width; i++)
+        if(_rt[i] == 0x0D && bitRead(_rtsegments, i / width)) {
+            length = i;
             break;
-        }
-        if(str[i] < 32 || str[i] > 126) str[i] = '?';
+        };
+    expected = (length == 16 * width) ? 0xFFFF : 
+               (word)((1UL << (length / width + 1)) - 1);
+    if((_rtsegments & expected) != expected) return;
+
+    _rtcomplete = true;
+    //FNV-1a, kept to 32 bits wherever unsigned long is wider
+    hash = 2166136261UL;
+    for(byte i = 0; i < length; i++)
+        hash = ((hash ^ (byte)_rt[i]) * 16777619UL) & 0xFFFFFFFFUL;
+    if(hash == _rthash) return;
+
+    _rthash = hash;
+    if(_onRadioText) _onRadioText(_status.radioText, hash);
+}
+
+void Si4735RDSDecoder::convertText(const char* raw, byte length, 
+                                   char* text){
+    byte c;
+    word unicode;
+    char ascii;
+
+    for(byte i = 0; i < length; i++) {
+        c = raw[i];
+        if(c == 0x0D) break;
+        switch(c) {
+            case 0x24: 
+                unicode = 0x00A4;
+                ascii = '$';
+                break;
+            case 0x5E: 
+                unicode = 0x2015;
+                ascii = '-';
+                break;
+            case 0x60:
+                unicode = 0x2016;
+                ascii = '|';
+                break;
+            case 0x7E:
+                unicode = 0x00AF;
+                ascii = '-';
+                break;
+            default:
+                if(c < 32 || c == 0x7F) unicode = ascii = '?';
+                else if(c < 0x80) unicode = ascii = c;
+                else {
+                    unicode = pgm_read_word(&Si4735_EBU2Unicode[c - 0x80]);
+                    ascii = pgm_read_byte(&Si4735_EBU2ASCII[c - 0x80]);
+                };
+        };
+        if(_charset == SI4735_RDS_CHARSET_UTF8 && unicode > 0x7F) {
+            if(unicode > 0x7FF) {
+                *text++ = 0xE0 | (unicode >> 12);
+                *text++ = 0x80 | ((unicode >> 6) & 0x3F);
+            } else *text++ = 0xC0 | (unicode >> 6);
+            *text++ = 0x80 | (unicode & 0x3F);
+        } else if(_charset == SI4735_RDS_CHARSET_LATIN1 && unicode <= 0xFF)
+            *text++ = unicode;
+        else *text++ = ascii;
     }
+    *text = '\0';
 }
 
 #if defined(SI4735_DEBUG)
@@ -210,6 +476,205 @@ void Si4735RDSDecoder::dumpRDSStats(void){
 }
 #endif
 
+void Si4735RDSRecorder::begin(Print* sink, word frequency){
+    _sink = sink;
+    _records = 0;
+    _start = millis();
+    if(!_sink) return;
+    _sink->write((const uint8_t *)SI4735_CAPTURE_MAGIC, 4);
+    writeLE(SI4735_CAPTURE_VERSION, 1);
+    writeLE(sizeof(Si4735_Capture_Record), 1);
+    writeLE(frequency, 2);
+    writeLE(0, 4);
+    writeLE(0, 4);
+}
+
+void Si4735RDSRecorder::record(word block[], byte errors){
+    if(!_sink) return;
+
+    writeLE(millis() - _start, 4);
+    for(byte i = 0; i < 4; i++) writeLE(block[i], 2);
+    writeLE(errors, 1);
+    writeLE(0, 3);
+    _records++;
+}
+
+void Si4735RDSRecorder::writeLE(uint32_t value, byte size){
+    //Byte by byte so that the file layout doesn't depend on our endianness
+    for(byte i = 0; i < size; i++) _sink->write(lowByte(value >> (i * 8)));
+}
+
+void Si4735RSQFilter::update(const Si4735_RX_Metrics* RSQ, bool FM){
+    updateMetric(SI4735_RSQ_RSSI, RSQ->RSSI);
+    updateMetric(SI4735_RSQ_SNR, RSQ->SNR);
+    if(FM) {
+        updateMetric(SI4735_RSQ_MULT, RSQ->MULT);
+        updateMetric(SI4735_RSQ_BLEND, RSQ->STBLEND);
+        updateMetric(SI4735_RSQ_FREQOFF, RSQ->FREQOFF);
+    };
+}
+
+void Si4735RSQFilter::reset(void){
+    memset((void *)_average, 0x00, sizeof(_average));
+    memset((void *)_variance, 0x00, sizeof(_variance));
+    memset((void *)_count, 0x00, sizeof(_count));
+}
+
+void Si4735RSQFilter::updateMetric(byte metric, int value){
+    long deviation;
+
+    if(!_count[metric]++) {
+        _average[metric] = (long)value << 8;
+        _min[metric] = _max[metric] = value;
+        return;
+    };
+
+    if(value < _min[metric]) _min[metric] = value;
+    if(value > _max[metric]) _max[metric] = value;
+    //Deviation in Q4 so that its square (Q8) can't overflow a long
+    deviation = (((long)value << 8) - _average[metric]) >> 4;
+    _average[metric] += (((long)value << 8) - _average[metric]) >> _shift;
+    _variance[metric] += (deviation * deviation - _variance[metric]) >>
+                         _shift;
+}
+
+void Si4735RSQHistory::add(word frequency, const Si4735_RX_Metrics* RSQ){
+    Station* station;
+
+    station = findStation(frequency);
+    if(!station) {
+        //Make room by dropping the station we heard from the longest ago
+        station = &_stations[0];
+        for(byte i = 1; i < SI4735_HISTORY_STATIONS; i++)
+            if(_stations[i].used < station->used) station = &_stations[i];
+        station->frequency = frequency;
+        station->head = 0;
+        station->count = 0;
+    };
+
+    station->used = ++_clock;
+    station->samples[station->head] = *RSQ;
+    station->head = (station->head + 1) % SI4735_HISTORY_DEPTH;
+    if(station->count < SI4735_HISTORY_DEPTH) station->count++;
+}
+
+byte Si4735RSQHistory::getCount(word frequency){
+    Station* station;
+
+    station = findStation(frequency);
+    return station ? station->count : 0;
+}
+
+bool Si4735RSQHistory::getSample(word frequency, byte age,
+                                 Si4735_RX_Metrics* RSQ){
+    Station* station;
+
+    station = findStation(frequency);
+    if(!station || age >= station->count) return false;
+
+    *RSQ = station->samples[(station->head + SI4735_HISTORY_DEPTH - 1 - age) %
+                            SI4735_HISTORY_DEPTH];
+    return true;
+}
+
+int Si4735RSQHistory::getTrend(word frequency, byte metric){
+    Station* station;
+    byte newest, oldest;
+
+    station = findStation(frequency);
+    if(!station || station->count < 2) return 0;
+
+    newest = (station->head + SI4735_HISTORY_DEPTH - 1) % SI4735_HISTORY_DEPTH;
+    oldest = (station->head + SI4735_HISTORY_DEPTH - station->count) %
+             SI4735_HISTORY_DEPTH;
+    return getMetric(&station->samples[newest], metric) - 
+           getMetric(&station->samples[oldest], metric);
+}
+
+void Si4735RSQHistory::reset(void){
+    memset((void *)_stations, 0x00, sizeof(_stations));
+    _clock = 0;
+}
+
+Si4735RSQHistory::Station* Si4735RSQHistory::findStation(word frequency){
+    for(byte i = 0; i < SI4735_HISTORY_STATIONS; i++)
+        if(_stations[i].count && _stations[i].frequency == frequency)
+            return &_stations[i];
+
+    return NULL;
+}
+
+int Si4735RSQHistory::getMetric(const Si4735_RX_Metrics* RSQ, byte metric){
+    switch(metric){
+        case SI4735_RSQ_RSSI:
+            return RSQ->RSSI;
+        case SI4735_RSQ_SNR:
+            return RSQ->SNR;
+        case SI4735_RSQ_MULT:
+            return RSQ->MULT;
+        case SI4735_RSQ_BLEND:
+            return RSQ->STBLEND;
+        case SI4735_RSQ_FREQOFF:
+            return RSQ->FREQOFF;
+    }
+
+    //Never reached
+    return 0;
+}
+
+bool Si4735BusArbiter::tryAcquire(const void* owner){
+    bool acquired;
+
+#if defined(SI4735_LINUX)
+    const void* expected = NULL;
+
+    acquired = __atomic_compare_exchange_n(&_owner, &expected, owner, false,
+                                           __ATOMIC_ACQUIRE,
+                                           __ATOMIC_RELAXED) ||
+               expected == owner;
+#else
+    noInterrupts();
+    acquired = (!_owner || _owner == owner);
+    if(acquired) _owner = owner;
+    interrupts();
+#endif
+    //Only the owner gets here, no need to guard the rest
+    if(acquired) _depth++;
+
+    return acquired;
+}
+
+void Si4735BusArbiter::acquire(const void* owner){
+    unsigned long start, waited;
+
+    if(!tryAcquire(owner)) {
+        _contentions++;
+        start = micros();
+        while(!tryAcquire(owner)) yield();
+        waited = micros() - start;
+        _waitTime += waited;
+        if(waited > _maxWait) _maxWait = waited;
+    };
+    _acquisitions++;
+}
+
+void Si4735BusArbiter::release(const void* owner){
+    if(_owner != owner || --_depth) return;
+
+#if defined(SI4735_LINUX)
+    __atomic_store_n(&_owner, (const void *)NULL, __ATOMIC_RELEASE);
+#else
+    _owner = NULL;
+#endif
+}
+
+void Si4735BusArbiter::resetStats(void){
+    _acquisitions = 0;
+    _contentions = 0;
+    _waitTime = 0;
+    _maxWait = 0;
+}
+
 const char Si4735_PTY2Text_S_None[] PROGMEM = "None/Undefined";
 const char Si4735_PTY2Text_S_News[] PROGMEM = "News";
 const char Si4735_PTY2Text_S_Current[] PROGMEM = "Current affairs";
@@ -356,7 +821,6 @@ byte Si4735Translate::translatePTY(byte PTY, byte fromlocale, byte tolocale){
 }
 
 void Si4735Translate::decodeCallSign(word programIdentifier, char* callSign){
-    //TODO: read the standard and implement world-wide PI decoding
     if(programIdentifier >= 21672){
         callSign[0] = 'W';
         programIdentifier -= 21672;
@@ -375,6 +839,130 @@ void Si4735Translate::decodeCallSign(word programIdentifier, char* callSign){
     } else strcpy(callSign, "UNKN");
 }
 
+//Country (ISO 3166) by ECC and PI country code, IEC 62106 Annex D. Rows go
+//by ECC: 0xA0-0xA6, 0xD0-0xD3, 0xE0-0xE4 and 0xF0-0xF4. "--" is unallocated.
+const char Si4735_ECC2Country[][31] PROGMEM = {
+    //ECC 0xA0, PI country 1 to F
+    "USUSUSUSUSUSUSUSUSUSUS--USUS--",
+    //ECC 0xA1, PI country 1 to F
+    "--------------------CACACACAGL",
+    //ECC 0xA2, PI country 1 to F
+    "AIAGECFKBBBZKYCRCUARBRBMANGPBS",
+    //ECC 0xA3, PI country 1 to F
+    "BOCOJMMQGFPYNI--PADMDOCLGDTCGY",
+    //ECC 0xA4, PI country 1 to F
+    "GTHNAW--MSTTPESRUYKNLCSVHTVE--",
+    //ECC 0xA5, PI country 1 to F
+    "--------------------MXVCMXMXMX",
+    //ECC 0xA6, PI country 1 to F
+    "----------------------------PM",
+    //ECC 0xD0, PI country 1 to F
+    "CMCFDJMGMLAOGQGAGNZABFCGTGBJMW",
+    //ECC 0xD1, PI country 1 to F
+    "NALRGHMRSTCVSNGMBI--BWKMTZETNG",
+    //ECC 0xD2, PI country 1 to F
+    "SLZWMZUGSZKESONETDGWCDCITZZM--",
+    //ECC 0xD3, PI country 1 to F
+    "----EH--RWLS--SC--MU--SD------",
+    //ECC 0xE0, PI country 1 to F
+    "DEDZADILITBERUPSALATHUMTDE--EG",
+    //ECC 0xE1, PI country 1 to F
+    "GRCYSMCHJOFILUBGDKGIIQGBLYROFR",
+    //ECC 0xE2, PI country 1 to F
+    "MACZPLVASKSYTN--LIISMCLTRSESNO",
+    //ECC 0xE3, PI country 1 to F
+    "MEIETRMK------NLLVLBAZHRKZSEBY",
+    //ECC 0xE4, PI country 1 to F
+    "MDEEKG----UAXKPTSIAMUZGE--TMBA",
+    //ECC 0xF0, PI country 1 to F
+    "AUAUAUAUAUAUAUAUSAAFMMCNKPBHMY",
+    //ECC 0xF1, PI country 1 to F
+    "KIBTBDPKFJOMNRIRNZSBBNLKTWKRHK",
+    //ECC 0xF2, PI country 1 to F
+    "KWQAKHWSINMO--VNPHJPSGMVIDAENP",
+    //ECC 0xF3, PI country 1 to F
+    "VULATHTO----------PG--YE----FM",
+    //ECC 0xF4, PI country 1 to F
+    "MN----------------------------"};
+
+//Language (ISO 639) by Language Identification Code, IEC 62106 Annex J
+const char Si4735_LIC2Language[] PROGMEM = 
+    "--sqbrcahrcycsdadeeneseoeteufofr"
+    "fygagdglisitselalvlblthumtnlnooc"
+    "plptrormsrskslfisvtrnlwa--------"
+    "--------------------------------"
+    "----------zuviuzurukthtetttatgsw"
+    "--sosisnsh--ruqupspafa--ornendmr"
+    "romsmgmklokokmkkknjaidhihehagngu"
+    "elkafffacvzhmybgbnbebmazashyaram";
+
+bool Si4735Translate::getCountry(word programIdentifier, byte ECC, 
+                                 char* country){
+    byte row, nibble;
+
+    nibble = programIdentifier >> 12;
+    row = ECC & 0x0F;
+    switch(ECC >> 4) {
+        case 0x0A:
+            if(row > 6) return false;
+            break;
+        case 0x0D:
+            if(row > 3) return false;
+            row += 7;
+            break;
+        case 0x0E:
+            if(row > 4) return false;
+            row += 11;
+            break;
+        case 0x0F:
+            if(row > 4) return false;
+            row += 16;
+            break;
+        default:
+            return false;
+    };
+    if(!nibble || pgm_read_byte(&Si4735_ECC2Country[row][(nibble - 1) * 2]) ==
+       '-') return false;
+
+    memcpy_P(country, &Si4735_ECC2Country[row][(nibble - 1) * 2], 2);
+    country[2] = '\0';
+
+    return true;
+}
+
+bool Si4735Translate::getLanguage(byte LIC, char* language){
+    if(LIC > 0x7F || pgm_read_byte(&Si4735_LIC2Language[LIC * 2]) == '-')
+        return false;
+
+    memcpy_P(language, &Si4735_LIC2Language[LIC * 2], 2);
+    language[2] = '\0';
+
+    return true;
+}
+
+//Checksum of the first length bytes of data, for structures meant to be 
+//stored away (Si4735_Calibration, Si4735_Snapshot)
+static byte Si4735_checksum(const void* data, word length){
+    byte sum = 0;
+
+    for(word i = 0; i < length; i++) sum += ((const byte *)data)[i];
+
+    return ~sum;
+}
+
+//Built-in band plan, indexed by SI4735_MODE_*. The AM and FM entries are
+//what the chip powers up with, which setMode() relies on.
+static const Si4735_Band_Plan Si4735_DefaultBandPlan[4] PROGMEM = {
+    //LW: 153kHz to 279kHz, on the 9kHz raster
+    {153, 279, 9, SI4735_FLG_DEEMPH_NONE, false},
+    //AM: 520kHz to 1710kHz
+    {520, 1710, 10, SI4735_FLG_DEEMPH_NONE, false},
+    //SW: 2.3MHz to 23MHz, seeking in the chip's default 10kHz steps
+    {2300, 23000, 10, SI4735_FLG_DEEMPH_NONE, true},
+    //FM: 87.5MHz to 107.9MHz
+    {8750, 10790, 10, SI4735_FLG_DEEMPH_75, false}
+};
+
 Si4735::Si4735(byte interface, byte pinPower, byte pinReset, byte pinGPO2,
                byte pinSEN){
     _mode = SI4735_MODE_FM;
@@ -382,6 +970,38 @@ Si4735::Si4735(byte interface, byte pinPower, byte pinReset, byte pinGPO2,
     _pinReset = pinReset;
     _pinGPO2 = pinGPO2;
     _pinSEN = pinSEN;
+    _slowshifter = true;
+    _arbiter = NULL;
+#if defined(SI4735_LINUX)
+    _transport = NULL;
+#endif
+    _patchSize = 0;
+    _patched = false;
+    _patchTime = 0;
+    _rsqsources = 0;
+    _rdsconfigured = false;
+    _rdsConfig = SI4735_FLG_BLETHA_35 | SI4735_FLG_BLETHB_35 | 
+                 SI4735_FLG_BLETHC_35 | SI4735_FLG_BLETHD_35;
+    _rdsConfidence = SI4735_RDS_CONFIDENCE_DEFAULT;
+    _tuneFlags = 0;
+    _antcap = 0;
+    _antcapTable = NULL;
+    _tuneTime = 0;
+    _poweredup = false;
+    _bandSW = false;
+    _bandPlan = Si4735_DefaultBandPlan;
+    _switchTime = 0;
+    _xosc = true;
+    _frequency = 0;
+    _watchdogTimeout = SI4735_WATCHDOG_TIMEOUT;
+    _recovering = false;
+    _recoveryFailed = false;
+    _errorStreak = 0;
+    _cachedProperties = 0;
+    memset(&_watchdogStats, 0x00, sizeof(_watchdogStats));
+    _booting = false;
+    _bootStart = 0;
+    _audioTime = 0;
     switch(interface){
         case SI4735_INTERFACE_SPI:
             _i2caddr = 0x00;
@@ -394,6 +1014,62 @@ Si4735::Si4735(byte interface, byte pinPower, byte pinReset, byte pinGPO2,
 }
 
 void Si4735::begin(byte mode, bool xosc, bool slowshifter){
+    //A recovery is no boot, keep the time-to-audio of the real one
+    if(!_recovering) {
+        _bootStart = micros();
+        _booting = true;
+        _audioTime = 0;
+    };
+    _slowshifter = slowshifter;
+    _poweredup = false;
+    //Hold the bus for the whole reset sequence, we wiggle SCLK by hand
+    if(_arbiter) _arbiter->acquire(this);
+    reset();
+    setMode(_mode, false, xosc);
+    if(_arbiter) _arbiter->release(this);
+}
+
+bool Si4735::resume(const Si4735_Snapshot* snapshot, 
+                    Si4735RDSDecoder* decoder, bool slowshifter){
+    Si4735_Band_Plan plan;
+
+    if(snapshot->version != SI4735_SNAPSHOT_VERSION || 
+       snapshot->checksum != Si4735_checksum(snapshot, 
+                                             offsetof(Si4735_Snapshot, 
+                                                      checksum)) ||
+       snapshot->mode > SI4735_MODE_FM || 
+       snapshot->properties > SI4735_WATCHDOG_PROPERTIES)
+        return false;
+
+    _bootStart = micros();
+    _booting = true;
+    _audioTime = 0;
+    if(decoder) decoder->setIdentity(snapshot);
+    _slowshifter = slowshifter;
+    _poweredup = false;
+    if(_arbiter) _arbiter->acquire(this);
+    reset();
+    _mode = snapshot->mode;
+    powerUp(((_mode == SI4735_MODE_FM) ? SI4735_FUNC_FM : SI4735_FUNC_AM),
+            snapshot->xosc);
+    //These already hold what setMode() would have written (unmute, band,
+    //interrupts) with whatever the application changed on top
+    _cachedProperties = snapshot->properties;
+    memcpy(_cacheProperty, snapshot->property, sizeof(_cacheProperty));
+    memcpy(_cacheValue, snapshot->value, sizeof(_cacheValue));
+    for(byte i = 0; i < _cachedProperties; i++)
+        setProperty(_cacheProperty[i], _cacheValue[i]);
+    getBandPlan(_mode, &plan);
+    _bandSW = plan.SW;
+    _rdsconfigured = snapshot->rds;
+    _rsqsources = snapshot->rsqSources;
+    if(_arbiter) _arbiter->release(this);
+    if(snapshot->frequency) setFrequency(snapshot->frequency);
+
+    return true;
+}
+
+void Si4735::reset(void){
     //Start by resetting the Si4735 and configuring the communication protocol
     if(_pinPower != SI4735_PIN_POWER_HW) pinMode(_pinPower, OUTPUT);
     pinMode(_pinReset, OUTPUT);
@@ -443,15 +1119,10 @@ void Si4735::begin(byte mode, bool xosc, bool slowshifter){
     
     if(!_i2caddr) {
 #if !defined(SI4735_NOSPI)
-        //Configure the SPI hardware
+        //Configure the SPI hardware; our clock, mode and bit order are only
+        //applied for the duration of each transaction, see 
+        //beginTransaction(), so that we can share the bus.
         SPI.begin();
-        //Datahseet says Si4735 can't do more than 2.5MHz on SPI and if you're
-        //level shifting through a BOB-08745, you can't do more than 250kHz 
-        SPI.setClockDivider((slowshifter ? SPI_CLOCK_DIV64 : SPI_CLOCK_DIV8));
-        //SCLK idle LOW, SDIO sampled on RISING edge
-        SPI.setDataMode(SPI_MODE0);
-        //Datasheet says Si4735 is big endian (MSB first)
-        SPI.setBitOrder(MSBFIRST);
 #endif
     } else {
 #if !defined(SI4735_NOI2C)
@@ -459,14 +1130,126 @@ void Si4735::begin(byte mode, bool xosc, bool slowshifter){
         Wire.begin();
 #endif
     };
-
-    setMode(_mode, false, xosc);
 }
 
-void Si4735::sendCommand(byte command, byte arg1, byte arg2, byte arg3, 
+byte Si4735::sendCommand(byte command, byte arg1, byte arg2, byte arg3, 
                          byte arg4, byte arg5, byte arg6, byte arg7){
     byte status;
 
+    //Once a recovery attempt failed, don't wait on the chip for the rest
+    if(_recovering && _recoveryFailed) return SI4735_STATUS_ERR;
+
+    for(byte attempt = 0; ; attempt++) {
+        status = startCommand(command, arg1, arg2, arg3, arg4, arg5, arg6,
+                              arg7);
+        status = waitForCTS(status);
+        if(!isFaulty(command, status)) return status;
+        if(_recovering) {
+            _recoveryFailed = true;
+            return status | SI4735_STATUS_ERR;
+        };
+        if(attempt || !recover()) return status | SI4735_STATUS_ERR;
+        //Recovery ends with the chip powered up, nothing left to send
+        if(command == SI4735_CMD_POWER_UP) return getStatus();
+    }
+}
+
+byte Si4735::waitForCTS(byte status){
+    unsigned long start;
+
+    //Each command takes a different time to decode inside the chip; readiness
+    //for next command and, indeed, availability/validity of reponse data is
+    //being signalled by CTS in status byte.
+    //Furthermore, the datasheet specifically mandates waiting for CTS to come
+    //back up before doing anything else, *including* attempting to read back
+    //the response from the last command sent.
+    //Therefore, we poll for CTS coming back up after we send the command.
+    start = millis();
+    while(!(status & SI4735_STATUS_CTS)) {
+        if(_watchdogTimeout && millis() - start >= _watchdogTimeout) break;
+        status = getStatus();
+    }
+
+    return status;
+}
+
+bool Si4735::isFaulty(byte command, byte status){
+    //Nothing to check on a chip we meant to power down
+    if(!_watchdogTimeout || command == SI4735_CMD_POWER_DOWN) return false;
+    if(!(status & SI4735_STATUS_CTS)) {
+        _watchdogStats.hangs++;
+        return true;
+    };
+    if(status == 0xFF) {
+        _watchdogStats.glitches++;
+        return true;
+    };
+    if(!(status & SI4735_STATUS_ERR)) {
+        _errorStreak = 0;
+        return false;
+    };
+    //Most likely the command's own fault (e.g. a property the current mode
+    //doesn't have), which is the caller's to handle: leave its response
+    //alone. A chip that lost its POWER_UP, though, fails every command;
+    //once enough have, ask it something it can't get wrong. Before 
+    //powerUp() is done (e.g. a patch chunk) ERR is never ours to handle.
+    if(!_poweredup || command == SI4735_CMD_POWER_UP ||
+       ++_errorStreak < SI4735_WATCHDOG_ERRORS) return false;
+    _errorStreak = 0;
+    status = waitForCTS(startCommand(SI4735_CMD_GET_REV));
+    if((status & SI4735_STATUS_CTS) && !(status & SI4735_STATUS_ERR))
+        return false;
+    _watchdogStats.errors++;
+
+    return true;
+}
+
+bool Si4735::recover(void){
+    byte rsqsources;
+    bool rdsconfigured;
+    word frequency;
+    unsigned long start, took;
+
+    start = micros();
+    _watchdogStats.recoveries++;
+    _recovering = true;
+    rsqsources = _rsqsources;
+    rdsconfigured = _rdsconfigured;
+    frequency = _frequency;
+    for(byte attempt = 0; attempt < SI4735_WATCHDOG_RETRIES; attempt++) {
+        _recoveryFailed = false;
+        begin(_mode, _xosc, _slowshifter);
+        //setMode() just wrote some of these, now put back what they were
+        for(byte i = 0; i < _cachedProperties; i++)
+            setProperty(_cacheProperty[i], _cacheValue[i]);
+        //Which also restored the RDS and RSQ interrupt configuration
+        _rdsconfigured = rdsconfigured;
+        _rsqsources = rsqsources;
+        enableInterrupts();
+        if(frequency && !_recoveryFailed) {
+            startTune(frequency);
+            took = millis();
+            while(!_recoveryFailed && !isSeekTuneComplete()) {
+                if(_watchdogTimeout && millis() - took >= _watchdogTimeout)
+                    _recoveryFailed = true;
+                delay(1);
+            }
+        };
+        if(!_recoveryFailed) break;
+    }
+    _recovering = false;
+    if(_recoveryFailed) _watchdogStats.failures++;
+    took = micros() - start;
+    _watchdogStats.lastRecovery = took;
+    if(took > _watchdogStats.maxRecovery) _watchdogStats.maxRecovery = took;
+
+    return !_recoveryFailed;
+}
+
+byte Si4735::startCommand(byte command, byte arg1, byte arg2, byte arg3, 
+                          byte arg4, byte arg5, byte arg6, byte arg7){
+    byte status = 0;
+
 #if defined(SI4735_DEBUG)
     Serial.print("Si4735 CMD 0x");
     Serial.print(command, HEX);
@@ -503,11 +1286,18 @@ void Si4735::sendCommand(byte command, byte arg1, byte arg2, byte arg3,
     Serial.flush();
 #endif
 
+#if defined(SI4735_LINUX)
+    if(_transport) {
+        byte buffer[8] = {command, arg1, arg2, arg3, arg4, arg5, arg6, arg7};
+
+        beginTransaction();
+        status = _transport->writeRead(buffer);
+        endTransaction();
+    } else
+#endif
     if(!_i2caddr) {
 #if !defined(SI4735_NOSPI)
-        digitalWrite(_pinSEN, LOW);
-        //Datasheet calls for 30ns, Arduino can only go as low as 3us
-        delayMicroseconds(5);
+        beginTransaction();
         SPI.transfer(SI4735_CP_WRITE8);
         SPI.transfer(command);
         SPI.transfer(arg1);
@@ -517,12 +1307,11 @@ void Si4735::sendCommand(byte command, byte arg1, byte arg2, byte arg3,
         SPI.transfer(arg5);
         SPI.transfer(arg6);
         SPI.transfer(arg7);
-        //Datahseet calls for 5ns, Arduino can only go as low as 3us
-        delayMicroseconds(5);
-        digitalWrite(_pinSEN, HIGH);
+        endTransaction();
 #endif
     } else {
 #if !defined(SI4735_NOI2C)
+        beginTransaction();
         Wire.beginTransmission(_i2caddr);
         Wire.write(command);
         Wire.write(arg1);
@@ -533,37 +1322,44 @@ void Si4735::sendCommand(byte command, byte arg1, byte arg2, byte arg3,
         Wire.write(arg6);
         Wire.write(arg7);
         Wire.endTransmission();
+        endTransaction();
 #endif
     };
-    
-    //Each command takes a different time to decode inside the chip; readiness
-    //for next command and, indeed, availability/validity of reponse data is
-    //being signalled by CTS in status byte.
-    //Furthermore, the datasheet specifically mandates waiting for CTS to come
-    //back up before doing anything else, *including* attempting to read back
-    //the response from the last command sent.
-    //Therefore, we poll for CTS coming back up after we send the command.
-    do {
-        status = getStatus();
-    } while(!(status & SI4735_STATUS_CTS));
+
+    return status;
 }
 
 void Si4735::setFrequency(word frequency){
+    startTune(frequency);
+    waitForInterrupt(SI4735_STATUS_STCINT);
+    completeSeekTune();
+}
+
+void Si4735::startTune(word frequency){
+    word antcap;
+
+    _tuneStart = micros();
+    _frequency = frequency;
     switch(_mode){
         case SI4735_MODE_FM:
-            sendCommand(SI4735_CMD_FM_TUNE_FREQ, 0x00, highByte(frequency),
-                        lowByte(frequency));
+            sendCommand(SI4735_CMD_FM_TUNE_FREQ, 
+                        _tuneFlags & (SI4735_FLG_FREEZE | SI4735_FLG_FAST),
+                        highByte(frequency), lowByte(frequency),
+                        lowByte(_antcap));
             break;
         case SI4735_MODE_AM:
         case SI4735_MODE_SW:
         case SI4735_MODE_LW:
-            sendCommand(SI4735_CMD_AM_TUNE_FREQ, 0x00, highByte(frequency), 
-                        lowByte(frequency), 0x00,
-                        ((_mode == SI4735_MODE_SW) ? 0x01 : 0x00));
+            //Datasheet recommends ANTCAP = 1 for SW unless told otherwise,
+            //elsewhere the table calibrateAntcap() built saves the chip 
+            //working it out
+            antcap = _antcap;
+            if(!antcap) antcap = (_bandSW ? 1 : lookupAntcap(frequency));
+            sendCommand(SI4735_CMD_AM_TUNE_FREQ, _tuneFlags & SI4735_FLG_FAST,
+                        highByte(frequency), lowByte(frequency),
+                        highByte(antcap), lowByte(antcap));
             break;
     }
-    waitForInterrupt(SI4735_STATUS_STCINT);
-    if(_mode == SI4735_MODE_FM) enableRDS();
 }
 
 byte Si4735::getRevision(char* FW, char* CMP, char* REV, word* patch){
@@ -601,46 +1397,143 @@ word Si4735::getFrequency(bool* valid){
     }    
     getResponse(_response);
     frequency = word(_response[2], _response[3]);
+    //Seeks end up wherever, remember where for recover()
+    if((_response[0] & SI4735_STATUS_CTS) && 
+       !(_response[0] & SI4735_STATUS_ERR))
+        _frequency = frequency;
 
     if(valid) *valid = (_response[1] & SI4735_STATUS_VALID);
     return frequency;
 }
 
 void Si4735::seekUp(bool wrap){
+    startSeek(true, wrap);
+    waitForInterrupt(SI4735_STATUS_STCINT);
+    completeSeekTune();
+}
+
+void Si4735::seekDown(bool wrap){
+    startSeek(false, wrap);
+    waitForInterrupt(SI4735_STATUS_STCINT);
+    completeSeekTune();
+}
+
+void Si4735::startSeek(bool up, bool wrap){
+    _tuneStart = micros();
     switch(_mode){
         case SI4735_MODE_FM:
             sendCommand(SI4735_CMD_FM_SEEK_START, 
-                        (SI4735_FLG_SEEKUP | 
+                        ((up ? SI4735_FLG_SEEKUP : 0x00) | 
                          (wrap ? SI4735_FLG_WRAP : 0x00)));
             break;
         case SI4735_MODE_AM:
         case SI4735_MODE_SW:
         case SI4735_MODE_LW:
             sendCommand(SI4735_CMD_AM_SEEK_START, 
-                        (SI4735_FLG_SEEKUP | (wrap ? SI4735_FLG_WRAP : 0x00)),
+                        ((up ? SI4735_FLG_SEEKUP : 0x00) | 
+                         (wrap ? SI4735_FLG_WRAP : 0x00)),
                         0x00, 0x00, 0x00, 
-                        ((_mode == SI4735_MODE_SW) ? 0x01 : 0x00));
+                        (_bandSW ? 0x01 : 0x00));
             break;
     }
-    waitForInterrupt(SI4735_STATUS_STCINT);
-    if(_mode == SI4735_MODE_FM) enableRDS();
 }
 
-void Si4735::seekDown(bool wrap){
-    switch(_mode){
-        case SI4735_MODE_FM:
-            sendCommand(SI4735_CMD_FM_SEEK_START, 
-                        (wrap ? SI4735_FLG_WRAP : 0x00));
-            break;
-        case SI4735_MODE_AM:
-        case SI4735_MODE_SW:
-        case SI4735_MODE_LW:
-            sendCommand(SI4735_CMD_AM_SEEK_START, 
-                        (wrap ? SI4735_FLG_WRAP : 0x00), 0x00, 0x00, 0x00, 
-                        ((_mode == SI4735_MODE_SW) ? 0x01 : 0x00));
-            break;
+word Si4735::seekRDS(const Si4735_RDS_Criteria* criteria, bool up, 
+                     word timeout){
+    Si4735_Band_Plan plan;
+    word start, previous, frequency, width, step, travelled;
+
+    if(_mode != SI4735_MODE_FM) return 0;
+
+    getBandPlan(_mode, &plan);
+    //Going past the top lands on the bottom one raster step later
+    width = plan.top - plan.bottom + plan.spacing;
+    start = previous = getFrequency();
+    travelled = 0;
+    while(true) {
+        if(up) seekUp();
+        else seekDown();
+        frequency = getFrequency();
+        //The seek wraps, so the only way to tell we went full circle is to
+        //add up the distance covered
+        step = (up ? frequency + width - previous : 
+                     previous + width - frequency) % width;
+        travelled += step;
+        if(!step || travelled >= width) break;
+        if(listenRDS(criteria, timeout)) return frequency;
+        previous = frequency;
     }
-    waitForInterrupt(SI4735_STATUS_STCINT);
+    setFrequency(start);
+
+    return 0;
+}
+
+bool Si4735::listenRDS(const Si4735_RDS_Criteria* criteria, word timeout){
+    unsigned long start;
+    word block[4];
+    byte errors, grouptype;
+    bool havePI, haveB, haveTA;
+
+    havePI = !criteria->PI;
+    haveB = false;
+    haveTA = !criteria->TA;
+    //Groups left over from the previous station would only confuse us
+    sendCommand(SI4735_CMD_FM_RDS_STATUS, 
+                SI4735_FLG_INTACK | SI4735_FLG_MTFIFO);
+    start = millis();
+    while(millis() - start < timeout) {
+        sendCommand(SI4735_CMD_GET_INT_STATUS);
+        if(!readRDSBlock(block, &errors)) {
+            //A group takes 87.6ms to come through
+            delay(10);
+            continue;
+        };
+        //Only trust blocks that came through with few enough errors
+        if(criteria->PI && ((errors & SI4735_RDS_BLEA_MASK) >> 
+                            SI4735_RDS_BLEA_SHR) <= SI4735_RDS_BLE_12) {
+            if(block[0] != criteria->PI) return false;
+            havePI = true;
+        };
+        if(((errors & SI4735_RDS_BLEB_MASK) >> SI4735_RDS_BLEB_SHR) <= 
+           SI4735_RDS_BLE_12) {
+            if((criteria->PTY != SI4735_RDS_PTY_ANY &&
+                ((block[1] & SI4735_RDS_PTY_MASK) >> SI4735_RDS_PTY_SHR) != 
+                criteria->PTY) ||
+               (criteria->TP && !(block[1] & SI4735_RDS_TP)))
+                return false;
+            haveB = true;
+            grouptype = lowByte((block[1] & SI4735_RDS_TYPE_MASK) >>
+                                SI4735_RDS_TYPE_SHR);
+            if(criteria->TA && (grouptype == SI4735_GROUP_0A || 
+                                grouptype == SI4735_GROUP_0B ||
+                                grouptype == SI4735_GROUP_15B)) {
+                if(!(block[1] & SI4735_RDS_TA)) return false;
+                haveTA = true;
+            };
+        };
+        if(havePI && haveB && haveTA) return true;
+    }
+
+    return false;
+}
+
+bool Si4735::isSeekTuneComplete(void){
+    //Same check as waitForInterrupt(), minus the waiting
+    if(!(getStatus() & SI4735_STATUS_STCINT)) {
+        sendCommand(SI4735_CMD_GET_INT_STATUS);
+        if(!(getStatus() & SI4735_STATUS_STCINT)) return false;
+    };
+    completeSeekTune();
+
+    return true;
+}
+
+void Si4735::completeSeekTune(void){
+    _tuneTime = micros() - _tuneStart;
+    if(_booting) {
+        _audioTime = micros() - _bootStart;
+        _booting = false;
+    };
     if(_mode == SI4735_MODE_FM) enableRDS();
 }
 
@@ -663,7 +1556,7 @@ void Si4735::setSeekThresholds(byte SNR, byte RSSI){
     }
 }
 
-bool Si4735::readRDSBlock(word* block){
+bool Si4735::readRDSBlock(word* block, byte* errors){
     //See if there's anything for us to do
     if(!(_mode == SI4735_MODE_FM && (getStatus() & SI4735_STATUS_RDSINT)))
         return false;
@@ -678,24 +1571,124 @@ bool Si4735::readRDSBlock(word* block){
     block[1] = word(_response[6], _response[7]);
     block[2] = word(_response[8], _response[9]);
     block[3] = word(_response[10], _response[11]);
+    if(errors) *errors = _response[12];
     
     return true;
 }
 
-void Si4735::getRSQ(Si4735_RX_Metrics* RSQ){
-    switch(_mode){
+bool Si4735::getRSQ(Si4735_RX_Metrics* RSQ){
+    byte status;
+
+    //Not startRSQ()/isRSQReady(), a chip that never raises CTS again would
+    //keep us here for good; sendCommand() gives up and recovers it
+    status = sendCommand((_mode == SI4735_MODE_FM) ? 
+                         SI4735_CMD_FM_RSQ_STATUS : SI4735_CMD_AM_RSQ_STATUS,
+                         SI4735_FLG_INTACK);
+    if(status & SI4735_STATUS_ERR) return false;
+    getResponse(_response);
+    decodeRSQ(RSQ);
+
+    return true;
+}
+
+void Si4735::startRSQ(void){
+    switch(_mode){
         case SI4735_MODE_FM:            
-            sendCommand(SI4735_CMD_FM_RSQ_STATUS, SI4735_FLG_INTACK);            
+            startCommand(SI4735_CMD_FM_RSQ_STATUS, SI4735_FLG_INTACK);
             break;
         case SI4735_MODE_AM:
         case SI4735_MODE_SW:
         case SI4735_MODE_LW:
-            sendCommand(SI4735_CMD_AM_RSQ_STATUS, SI4735_FLG_INTACK);            
+            startCommand(SI4735_CMD_AM_RSQ_STATUS, SI4735_FLG_INTACK);
             break;
     }    
+}
+
+bool Si4735::isRSQReady(Si4735_RX_Metrics* RSQ){
+    if(!(getStatus() & SI4735_STATUS_CTS)) return false;
     //Now read the response    
     getResponse(_response);    
+    decodeRSQ(RSQ);
+
+    return true;
+}
+
+void Si4735::setRSQThresholds(byte metric, byte low, byte high){
+    byte sources = _rsqsources;
+
+    switch(metric){
+        case SI4735_RSQ_RSSI:
+            setProperty((_mode == SI4735_MODE_FM) ? 
+                        SI4735_PROP_FM_RSQ_RSSI_LO_THRESHOLD :
+                        SI4735_PROP_AM_RSQ_RSSI_LOW_THRESHOLD, 
+                        word(0x00, low));
+            setProperty((_mode == SI4735_MODE_FM) ? 
+                        SI4735_PROP_FM_RSQ_RSSI_HI_THRESHOLD :
+                        SI4735_PROP_AM_RSQ_RSSI_HIGH_THRESHOLD, 
+                        word(0x00, high));
+            sources |= SI4735_STATUS_RSSILINT | SI4735_STATUS_RSSIHINT;
+            break;
+        case SI4735_RSQ_SNR:
+            setProperty((_mode == SI4735_MODE_FM) ? 
+                        SI4735_PROP_FM_RSQ_SNR_LO_THRESHOLD :
+                        SI4735_PROP_AM_RSQ_SNR_LOW_THRESHOLD, 
+                        word(0x00, low));
+            setProperty((_mode == SI4735_MODE_FM) ? 
+                        SI4735_PROP_FM_RSQ_SNR_HI_THRESHOLD :
+                        SI4735_PROP_AM_RSQ_SNR_HIGH_THRESHOLD, 
+                        word(0x00, high));
+            sources |= SI4735_STATUS_SNRLINT | SI4735_STATUS_SNRHINT;
+            break;
+        case SI4735_RSQ_MULT:
+            if(_mode != SI4735_MODE_FM) return;
+            setProperty(SI4735_PROP_FM_RSQ_MULTIPATH_LO_THRESHOLD,
+                        word(0x00, low));
+            setProperty(SI4735_PROP_FM_RSQ_MULTIPATH_HI_THRESHOLD,
+                        word(0x00, high));
+            sources |= SI4735_STATUS_MULTLINT | SI4735_STATUS_MULTHINT;
+            break;
+        case SI4735_RSQ_BLEND:
+            if(_mode != SI4735_MODE_FM) return;
+            setProperty(SI4735_PROP_FM_RSQ_BLEND_THRESHOLD, word(0x00, low));
+            sources |= SI4735_STATUS_BLENDINT;
+            break;
+    }
+    setRSQInterrupts(sources);
+}
+
+void Si4735::setRSQInterrupts(byte sources){
+    byte previous = _rsqsources;
+
+    //AM has neither multipath nor blend detection
+    if(_mode != SI4735_MODE_FM)
+        sources &= SI4735_STATUS_SNRHINT | SI4735_STATUS_SNRLINT |
+                   SI4735_STATUS_RSSIHINT | SI4735_STATUS_RSSILINT;
+    //INT_SOURCE enable bits sit where the corresponding status bits do
+    setProperty((_mode == SI4735_MODE_FM) ? SI4735_PROP_FM_RSQ_INT_SOURCE :
+                SI4735_PROP_AM_RSQ_INTERRUPTS, word(0x00, sources));
+    _rsqsources = sources;
+    //Only touch GPO_IEN when RSQIEN actually has to change
+    if(!previous != !sources) enableInterrupts();
+}
+
+byte Si4735::getRSQEvents(Si4735_RX_Metrics* RSQ){
+    byte status;
+
+    //A plain status read may show stale interrupt bits, see 
+    //waitForInterrupt()
+    status = sendCommand(SI4735_CMD_GET_INT_STATUS);
+    if((status & SI4735_STATUS_ERR) || !(status & SI4735_STATUS_RSQINT)) 
+        return 0;
+
+    sendCommand((_mode == SI4735_MODE_FM) ? SI4735_CMD_FM_RSQ_STATUS :
+                SI4735_CMD_AM_RSQ_STATUS, SI4735_FLG_INTACK);
+    getResponse(_response);
+    if(RSQ) decodeRSQ(RSQ);
 
+    return _response[1] & _rsqsources;
+}
+
+void Si4735::decodeRSQ(Si4735_RX_Metrics* RSQ){
     //Pull the response data into their respecive fields
     RSQ->RSSI = _response[4];
     RSQ->SNR = _response[5];
@@ -704,6 +1697,12 @@ void Si4735::getRSQ(Si4735_RX_Metrics* RSQ){
         RSQ->STBLEND = (_response[3] & (~SI4735_STATUS_PILOT));
         RSQ->MULT = _response[6];
         RSQ->FREQOFF = _response[7];
+    } else {
+        //AM has none of these, don't leave whatever was there
+        RSQ->PILOT = false;
+        RSQ->STBLEND = 0;
+        RSQ->MULT = 0;
+        RSQ->FREQOFF = 0;
     }
 }
 
@@ -738,50 +1737,58 @@ void Si4735::unMute(bool minvol){
 byte Si4735::getStatus(void){
     byte response = 0;
 
+#if defined(SI4735_LINUX)
+    if(_transport) {
+        beginTransaction();
+        _transport->read(&response, 1);
+        endTransaction();
+    } else
+#endif
     if(!_i2caddr) {
 #if !defined(SI4735_NOSPI)
-        digitalWrite(_pinSEN, LOW);
-        //Datasheet calls for 30ns, Arduino can only go as low as 3us
-        delayMicroseconds(5);
+        beginTransaction();
         SPI.transfer(SI4735_CP_READ1_GPO1);
         response = SPI.transfer(0x00);
-        //Datahseet calls for 5ns, Arduino can only go as low as 3us
-        delayMicroseconds(5);
-        digitalWrite(_pinSEN, HIGH);
+        endTransaction();
 #endif
     } else {
 #if !defined(SI4735_NOI2C)
-        Wire.requestFrom((uint8_t)_i2caddr, (uint8_t)1);
-        //I2C runs at 100kHz when using the Wire library, 100kHz = 10us period
-        //so wait 10 bit-times for something to become available.
-        while(!Wire.available()) delayMicroseconds(100);
-        response = Wire.read();
+        beginTransaction();
+        //A chip that doesn't ACK (e.g. browned out) leaves nothing to read,
+        //report that the way an undriven SPI bus would: all 1s
+        if(Wire.requestFrom((uint8_t)_i2caddr, (uint8_t)1) == 1) 
+            response = Wire.read();
+        else response = 0xFF;
+        endTransaction();
 #endif
     };
     return response;
 }
 
 void Si4735::getResponse(byte* response){
+#if defined(SI4735_LINUX)
+    if(_transport) {
+        beginTransaction();
+        _transport->read(response, 16);
+        endTransaction();
+    } else
+#endif
     if(!_i2caddr) {
 #if !defined(SI4735_NOSPI)
-        digitalWrite(_pinSEN, LOW);
-        //Datasheet calls for 30ns, Arduino can only go as low as 3us
-        delayMicroseconds(5);
+        beginTransaction();
         SPI.transfer(SI4735_CP_READ16_GPO1);
         for(int i = 0; i < 16; i++) response[i] = SPI.transfer(0x00);
-        //Datahseet calls for 5ns, Arduino can only go as low as 3us
-        delayMicroseconds(5);
-        digitalWrite(_pinSEN, HIGH);
+        endTransaction();
 #endif
     } else {
 #if !defined(SI4735_NOI2C)
-        Wire.requestFrom((uint8_t)_i2caddr, (uint8_t)16);
-        for(int i = 0; i < 16; i++) {
-            //I2C runs at 100kHz when using the Wire library, 100kHz = 10us
-            //period so wait 10 bit-times for something to become available.
-            while(!Wire.available()) delayMicroseconds(100);
-            response[i] = Wire.read();          
-        }
+        beginTransaction();
+        //requestFrom() only returns once the transfer is over, whatever it
+        //got is all there will be; a short read looks like getStatus() does
+        if(Wire.requestFrom((uint8_t)_i2caddr, (uint8_t)16) == 16)
+            for(int i = 0; i < 16; i++) response[i] = Wire.read();
+        else memset(response, 0xFF, 16);
+        endTransaction();
 #endif
     };
 
@@ -806,19 +1813,41 @@ void Si4735::getResponse(byte* response){
 #endif
 }
 
-void Si4735::end(bool hardoff){
+void Si4735::end(bool hardoff, Si4735_Snapshot* snapshot,
+                 Si4735RDSDecoder* decoder){
+    if(snapshot) getSnapshot(snapshot, decoder);
     sendCommand(SI4735_CMD_POWER_DOWN);
+    _poweredup = false;
     if(hardoff) {
         //datasheet calls for 10ns, Arduino can only go as low as 3us
         delayMicroseconds(5);
 #if !defined(SI4735_NOSPI)        
-        if(!_i2caddr) SPI.end();
+        //Leave a shared bus alone, others may still be using it
+        if(!_i2caddr && !_arbiter) SPI.end();
 #endif
         digitalWrite(_pinReset, LOW);
         if(_pinPower != SI4735_PIN_POWER_HW) digitalWrite(_pinPower, LOW);
     };
 }
 
+void Si4735::getSnapshot(Si4735_Snapshot* snapshot, 
+                         Si4735RDSDecoder* decoder){
+    memset(snapshot, 0x00, sizeof(Si4735_Snapshot));
+    snapshot->version = SI4735_SNAPSHOT_VERSION;
+    snapshot->mode = _mode;
+    snapshot->xosc = _xosc;
+    snapshot->rds = _rdsconfigured;
+    snapshot->rsqSources = _rsqsources;
+    //Seeks may have moved it since the last tune, ask
+    snapshot->frequency = (_poweredup ? getFrequency() : _frequency);
+    snapshot->properties = _cachedProperties;
+    memcpy(snapshot->property, _cacheProperty, sizeof(_cacheProperty));
+    memcpy(snapshot->value, _cacheValue, sizeof(_cacheValue));
+    if(decoder) decoder->getIdentity(snapshot);
+    snapshot->checksum = Si4735_checksum(snapshot, 
+                                         offsetof(Si4735_Snapshot, checksum));
+}
+
 void Si4735::setDeemphasis(byte deemph){
     switch(_mode){
         case SI4735_MODE_FM:            
@@ -833,60 +1862,114 @@ void Si4735::setDeemphasis(byte deemph){
 }
 
 void Si4735::setMode(byte mode, bool powerdown, bool xosc){
+    Si4735_Band_Plan previous;
+    byte function;
+    unsigned long start;
+
+    start = micros();
+    function = ((mode == SI4735_MODE_FM) ? SI4735_FUNC_FM : SI4735_FUNC_AM);
+    //AM, SW and LW share the AM firmware: properties, RSQ thresholds and 
+    //any patch all survive, only the band needs changing
+    if(_poweredup && function == ((_mode == SI4735_MODE_FM) ? 
+                                  SI4735_FUNC_FM : SI4735_FUNC_AM)) {
+        getBandPlan(_mode, &previous);
+        _mode = mode;
+        applyBandPlan(&previous);
+        _switchTime = micros() - start;
+        return;
+    };
+
     if(powerdown) end(false);
     _mode = mode;
+    //POWER_UP wipes the properties, unless recover() is about to put them back
+    if(!_recovering) _cachedProperties = 0;
+    powerUp(function, xosc);
+
+    //Disable Mute
+    unMute();
+
+    //Set the seek band for the desired mode, starting from the defaults the
+    //chip just powered up with
+    memcpy_P(&previous, &Si4735_DefaultBandPlan[(function == SI4735_FUNC_FM) ?
+                                                SI4735_MODE_FM : 
+                                                SI4735_MODE_AM],
+             sizeof(Si4735_Band_Plan));
+    applyBandPlan(&previous);
     
-    switch(_mode){
-        case SI4735_MODE_FM:
-            sendCommand(SI4735_CMD_POWER_UP, SI4735_FLG_GPO2IEN | 
-                        (xosc ? SI4735_FLG_XOSCEN : 0x00) | SI4735_FUNC_FM,
-                        SI4735_OUT_ANALOG);
-            break;
-        case SI4735_MODE_AM:
-        case SI4735_MODE_SW:
-        case SI4735_MODE_LW:
-            sendCommand(SI4735_CMD_POWER_UP, SI4735_FLG_GPO2IEN | 
-                        (xosc ? SI4735_FLG_XOSCEN : 0x00) | SI4735_FUNC_AM,
-                        SI4735_OUT_ANALOG);
-            break;
-    }
+    //The chip forgot any RSQ thresholds and RDS configuration we had when
+    //it powered up
+    _rsqsources = 0;
+    _rdsconfigured = false;
+    enableInterrupts();
+    _switchTime = micros() - start;
+}
+
+void Si4735::powerUp(byte function, bool xosc){
+    bool patch;
+
+    _xosc = xosc;
+    patch = (_patchSize && _patchFunction == function);
+    sendCommand(SI4735_CMD_POWER_UP, SI4735_FLG_GPO2IEN | 
+                (xosc ? SI4735_FLG_XOSCEN : 0x00) |
+                (patch ? SI4735_FLG_PATCH : 0x00) | function,
+                SI4735_OUT_ANALOG);
+    //The patch must go in before any other command is sent; a chunk that
+    //fails with ERR ends the upload, it doesn't set the watchdog off
+    _patched = patch && uploadPatch();
 
     //Configure GPO lines to maximize stability
     sendCommand(SI4735_CMD_GPIO_CTL, SI4735_FLG_GPO1OEN | SI4735_FLG_GPO2OEN);
     sendCommand(SI4735_CMD_GPIO_SET, SI4735_FLG_GPO2LEVEL);
+    _poweredup = true;
+    _errorStreak = 0;
+}
 
-    //Disable Mute
-    unMute();
+void Si4735::setBandPlan(const Si4735_Band_Plan* table){
+    _bandPlan = (table ? table : Si4735_DefaultBandPlan);
+}
 
-    //Set the seek band for the desired mode (AM and FM can use defaults)
-    switch(_mode){
-        case SI4735_MODE_SW:
-            //Set the lower band limit for Short Wave Radio to 2.3 MHz
-            setProperty(SI4735_PROP_AM_SEEK_BAND_BOTTOM, 0x08FC);            
-            //Set the upper band limit for Short Wave Radio to 23 MHz
-            setProperty(SI4735_PROP_AM_SEEK_BAND_TOP, 0x59D8);
-            break;
-        case SI4735_MODE_LW:
-            //Set the lower band limit for Long Wave Radio to 152 kHz
-            setProperty(SI4735_PROP_AM_SEEK_BAND_BOTTOM, 0x0099);            
-            //Set the upper band limit for Long Wave Radio to 279 kHz
-            setProperty(SI4735_PROP_AM_SEEK_BAND_BOTTOM, 0x0117);                            
-            break;
-    }
-    
-    //Enable end-of-seek and RDS interrupts
-    //TODO: write interrupt handlers for STCINT and RDSINT
-    setProperty(
-        SI4735_PROP_GPO_IEN, 
-        word(0x00, ((_mode == SI4735_MODE_FM) ? SI4735_FLG_RDSIEN : 0x00) | 
-             SI4735_FLG_STCIEN));
+void Si4735::getBandPlan(byte mode, Si4735_Band_Plan* plan){
+    memcpy_P(plan, &_bandPlan[mode], sizeof(Si4735_Band_Plan));
+}
+
+void Si4735::applyBandPlan(const Si4735_Band_Plan* previous){
+    Si4735_Band_Plan plan;
+    bool FM;
+
+    getBandPlan(_mode, &plan);
+    FM = (_mode == SI4735_MODE_FM);
+    if(plan.bottom != previous->bottom)
+        setProperty((FM ? SI4735_PROP_FM_SEEK_BAND_BOTTOM : 
+                     SI4735_PROP_AM_SEEK_BAND_BOTTOM), plan.bottom);
+    if(plan.top != previous->top)
+        setProperty((FM ? SI4735_PROP_FM_SEEK_BAND_TOP : 
+                     SI4735_PROP_AM_SEEK_BAND_TOP), plan.top);
+    if(plan.spacing != previous->spacing)
+        setProperty((FM ? SI4735_PROP_FM_SEEK_FREQ_SPACING : 
+                     SI4735_PROP_AM_SEEK_FREQ_SPACING), plan.spacing);
+    if(plan.deemphasis != previous->deemphasis) setDeemphasis(plan.deemphasis);
+    _bandSW = plan.SW;
 }
 
 void Si4735::setProperty(word property, word value){
+    //Remember it for recover(), which replays the cache itself
+    if(!_recovering) cacheProperty(property, value);
     sendCommand(SI4735_CMD_SET_PROPERTY, 0x00, highByte(property), 
                 lowByte(property), highByte(value), lowByte(value));
 }
 
+void Si4735::cacheProperty(word property, word value){
+    byte i;
+
+    for(i = 0; i < _cachedProperties; i++)
+        if(_cacheProperty[i] == property) break;
+    if(i < SI4735_WATCHDOG_PROPERTIES) {
+        _cacheProperty[i] = property;
+        _cacheValue[i] = value;
+        if(i == _cachedProperties) _cachedProperties++;
+    } else _watchdogStats.uncached++;
+}
+
 word Si4735::getProperty(word property){    
     sendCommand(SI4735_CMD_GET_PROPERTY, 0x00, highByte(property), 
                 lowByte(property));
@@ -895,22 +1978,890 @@ word Si4735::getProperty(word property){
     return word(_response[2], _response[3]);
 }
 
-void Si4735::enableRDS(void){
-    //Enable and configure RDS reception
+//Sorts a small array of bytes in place, ascending
+static void Si4735_sortBytes(byte* values, byte count){
+    byte value, j;
+
+    for(byte i = 1; i < count; i++) {
+        value = values[i];
+        for(j = i; j && values[j - 1] > value; j--) values[j] = values[j - 1];
+        values[j] = value;
+    }
+}
+
+
+bool Si4735::calibrate(Si4735_Calibration* calibration){
+    Si4735_Band_Plan plan;
+    Si4735_RX_Metrics RSQ;
+    byte RSSI[SI4735_CALIBRATION_SAMPLES], SNR[SI4735_CALIBRATION_SAMPLES];
+    byte count, first, stationRSSI, stationSNR;
+    word start, frequency, step;
+
+    getBandPlan(_mode, &plan);
+    //A custom band plan may not make sense
+    if(!plan.spacing || plan.bottom > plan.top) return false;
+    start = getFrequency();
+    //Spread the samples evenly over the band
+    step = ((plan.top - plan.bottom) / plan.spacing / 
+            SI4735_CALIBRATION_SAMPLES + 1) * plan.spacing;
+    count = 0;
+    for(frequency = plan.bottom; 
+        frequency <= plan.top && count < SI4735_CALIBRATION_SAMPLES;
+        frequency += step) {
+        setFrequency(frequency);
+        if(!getRSQ(&RSQ)) return false;
+        RSSI[count] = RSQ.RSSI;
+        SNR[count] = RSQ.SNR;
+        count++;
+    }
+    setFrequency(start);
+    if(!count) return false;
+    Si4735_sortBytes(RSSI, count);
+    Si4735_sortBytes(SNR, count);
+
+    memset((void *)calibration, 0x00, sizeof(Si4735_Calibration));
+    calibration->mode = _mode;
+    //Most of any band is empty channels, almost everywhere
+    calibration->noiseRSSI = RSSI[count / 4];
+    calibration->noiseSNR = SNR[count / 4];
+    //Anything 10dB or more above that is taken to be a station
+    for(first = count / 4; 
+        first < count && RSSI[first] < calibration->noiseRSSI + 10; first++);
+    calibration->stations = count - first;
+    if(!calibration->stations) return false;
+    //The typical station is the median of those; stations are also the best
+    //SNRs, so the same goes for them
+    stationRSSI = RSSI[(first + count) / 2];
+    stationSNR = SNR[count - (calibration->stations + 1) / 2];
+    calibration->seekRSSI = calibration->noiseRSSI + 
+                            max((stationRSSI - calibration->noiseRSSI) / 3, 3);
+    calibration->seekSNR = calibration->noiseSNR + 
+                           max((stationSNR - calibration->noiseSNR) / 3, 2);
+    //With strong stations about, errors are rare and a block needing 3-5 
+    //corrections is more likely miscorrected than not: only take 1-2 and be
+    //stricter on confidence. Weak ones need all the help they can get.
+    if(stationSNR >= 20) {
+        calibration->rdsConfig = SI4735_FLG_BLETHA_12 | SI4735_FLG_BLETHB_12 |
+                                 SI4735_FLG_BLETHC_12 | SI4735_FLG_BLETHD_12;
+        calibration->rdsConfidence = 0x3333;
+    } else {
+        calibration->rdsConfig = SI4735_FLG_BLETHA_35 | SI4735_FLG_BLETHB_35 |
+                                 SI4735_FLG_BLETHC_35 | SI4735_FLG_BLETHD_35;
+        calibration->rdsConfidence = ((stationSNR >= 10) ? 0x2222 : 
+                                      SI4735_RDS_CONFIDENCE_DEFAULT);
+    };
+    calibration->checksum = Si4735_checksum(
+        calibration, offsetof(Si4735_Calibration, checksum));
+
+    return setCalibration(calibration);
+}
+
+bool Si4735::calibrateAntcap(Si4735_Antcap_Table* table){
+    Si4735_Band_Plan plan;
+    const Si4735_Antcap_Table* previous;
+    word start, frequency, antcap, channels, stride;
+    unsigned long automatic, cached;
+    bool tuned;
+
+    if(_mode == SI4735_MODE_FM || _bandSW) return false;
+
+    getBandPlan(_mode, &plan);
+    if(!plan.spacing || plan.bottom >= plan.top) return false;
+    start = getFrequency();
+    memset((void *)table, 0x00, sizeof(Si4735_Antcap_Table));
+    table->mode = _mode;
+    table->bottom = plan.bottom;
+    //Cover the whole band, on its raster: the stride is rounded up, so fewer
+    //points may do and the last one is pulled back onto the top channel
+    channels = (plan.top - plan.bottom) / plan.spacing;
+    stride = (channels + SI4735_ANTCAP_POINTS - 2) / (SI4735_ANTCAP_POINTS - 1);
+    table->points = (channels + stride - 1) / stride + 1;
+    table->step = stride * plan.spacing;
+    table->top = plan.bottom + channels * plan.spacing;
+    //Let the chip work every value out, whatever we were told to use
+    antcap = _antcap;
+    previous = _antcapTable;
+    _antcap = 0;
+    _antcapTable = NULL;
+    automatic = 0;
+    tuned = true;
+    for(byte i = 0; tuned && i < table->points; i++) {
+        frequency = min((word)(table->bottom + i * table->step), table->top);
+        //Not setFrequency(), which only polls every 125ms
+        startTune(frequency);
+        tuned = waitForTune();
+        automatic += _tuneTime;
+        sendCommand(SI4735_CMD_AM_TUNE_STATUS, SI4735_FLG_INTACK);
+        getResponse(_response);
+        table->value[i] = word(_response[6], _response[7]);
+    }
+    _antcapTable = table;
+    cached = 0;
+    for(byte i = 0; tuned && i < table->points; i++) {
+        frequency = min((word)(table->bottom + i * table->step), table->top);
+        startTune(frequency);
+        tuned = waitForTune();
+        cached += _tuneTime;
+        sendCommand(SI4735_CMD_AM_TUNE_STATUS, SI4735_FLG_INTACK);
+    }
+    _antcap = antcap;
+    if(!tuned) {
+        //A chip that hung halfway is no judge of its own antenna
+        _antcapTable = previous;
+        return false;
+    };
+    table->automaticTime = automatic / table->points;
+    table->cachedTime = cached / table->points;
+    table->checksum = Si4735_checksum(
+        table, offsetof(Si4735_Antcap_Table, checksum));
+    setFrequency(start);
+
+    return true;
+}
+
+bool Si4735::setAntcapTable(const Si4735_Antcap_Table* table){
+    if(table && (table->checksum != Si4735_checksum(
+                     table, offsetof(Si4735_Antcap_Table, checksum)) ||
+                 table->points < 2 || table->points > SI4735_ANTCAP_POINTS ||
+                 !table->step || table->top <= table->bottom + 
+                                 (table->points - 2) * table->step))
+        return false;
+
+    _antcapTable = table;
+
+    return true;
+}
+
+word Si4735::lookupAntcap(word frequency){
+    const Si4735_Antcap_Table* table;
+    word offset, segment, span;
+    long low, high;
+
+    table = _antcapTable;
+    if(!table || table->mode != _mode || frequency < table->bottom ||
+       frequency > table->top) return 0;
+    offset = frequency - table->bottom;
+    segment = min((word)(offset / table->step), (word)(table->points - 2));
+    offset -= segment * table->step;
+    //The last segment ends on top, usually short of a full step
+    span = ((segment == table->points - 2) ? 
+            table->top - table->bottom - segment * table->step : table->step);
+    low = table->value[segment];
+    high = table->value[segment + 1];
+
+    return low + (high - low) * offset / span;
+}
+
+bool Si4735::waitForTune(void){
+    unsigned long start;
+
+    start = millis();
+    while(!isSeekTuneComplete()) {
+        if(_watchdogTimeout && millis() - start >= _watchdogTimeout)
+            return false;
+        delay(1);
+    }
+
+    return true;
+}
+
+bool Si4735::setCalibration(const Si4735_Calibration* calibration){
+    if(calibration->checksum != Si4735_checksum(
+           calibration, offsetof(Si4735_Calibration, checksum)) ||
+       (calibration->mode == SI4735_MODE_FM) != (_mode == SI4735_MODE_FM))
+        return false;
+
+    setSeekThresholds(calibration->seekSNR, calibration->seekRSSI);
     if(_mode == SI4735_MODE_FM) {
+        _rdsConfig = calibration->rdsConfig;
+        _rdsConfidence = calibration->rdsConfidence;
+        //Already configured RDS has to be told too
+        if(_rdsconfigured) {
+            _rdsconfigured = false;
+            enableRDS();
+            if(_rdsConfidence == SI4735_RDS_CONFIDENCE_DEFAULT)
+                setProperty(SI4735_PROP_FM_RDS_CONFIDENCE, _rdsConfidence);
+        };
+    };
+
+    return true;
+}
+
+void Si4735::enableRDS(void){
+    //Enable and configure RDS reception, once per POWER_UP is enough as the
+    //chip keeps its properties across tunes and seeks
+    if(_mode == SI4735_MODE_FM && !_rdsconfigured) {
+        _rdsconfigured = true;
         setProperty(SI4735_PROP_FM_RDS_INT_SOURCE, word(0x00, 
                                                         SI4735_FLG_RDSRECV));
         setProperty(SI4735_PROP_FM_RDS_INT_FIFO_COUNT, word(0x00, 0x01));
-        setProperty(SI4735_PROP_FM_RDS_CONFIG, word(SI4735_FLG_BLETHA_35 | 
-                    SI4735_FLG_BLETHB_35 | SI4735_FLG_BLETHC_35 | 
-                    SI4735_FLG_BLETHD_35, SI4735_FLG_RDSEN));
+        setProperty(SI4735_PROP_FM_RDS_CONFIG, word(_rdsConfig, 
+                                                    SI4735_FLG_RDSEN));
+        if(_rdsConfidence != SI4735_RDS_CONFIDENCE_DEFAULT)
+            setProperty(SI4735_PROP_FM_RDS_CONFIDENCE, _rdsConfidence);
     };
 }
 
+bool Si4735::setPatch(const byte* image, word size, word patchID,
+                      byte function){
+    _patchImage = image;
+#if !defined(SI4735_LINUX)
+    _patchStream = NULL;
+#endif
+    //A partial command at the end would be silently dropped, refuse it
+    _patchSize = (size % 8) ? 0 : size;
+    _patchID = patchID;
+    _patchFunction = function;
+
+    return !(size % 8);
+}
+
+#if !defined(SI4735_LINUX)
+bool Si4735::setPatch(Stream* image, word size, word patchID, byte function){
+    _patchImage = NULL;
+    _patchStream = image;
+    _patchSize = (size % 8) ? 0 : size;
+    _patchID = patchID;
+    _patchFunction = function;
+
+    return !(size % 8);
+}
+#endif
+
+bool Si4735::uploadPatch(void){
+    byte chunk[8];
+    word patch, size;
+    unsigned long start;
+
+    start = micros();
+    size = _patchSize;
+#if !defined(SI4735_LINUX)
+    //A Stream is consumed by the upload, later POWER_UPs go unpatched 
+    //rather than read past the end of the image
+    if(_patchStream) _patchSize = 0;
+#endif
+    //The image is a sequence of complete PATCH_ARGS/PATCH_DATA commands, 8
+    //bytes each, which we feed to the chip as they are; only one of them is
+    //ever held in RAM.
+    for(word offset = 0; offset < size; offset += 8) {
+#if !defined(SI4735_LINUX)
+        if(_patchStream) {
+            if(_patchStream->readBytes(chunk, 8) != 8) return false;
+        } else
+#endif
+            for(byte i = 0; i < 8; i++)
+                chunk[i] = pgm_read_byte(&_patchImage[offset + i]);
+        //sendCommand() already polls for CTS as tightly as the bus allows
+        if(sendCommand(chunk[0], chunk[1], chunk[2], chunk[3], chunk[4],
+                       chunk[5], chunk[6], chunk[7]) & SI4735_STATUS_ERR)
+            return false;
+    }
+    _patchTime = micros() - start;
+    //Check that the chip is now running the patch we expected
+    if(_patchID) {
+        getRevision(NULL, NULL, NULL, &patch);
+        if(patch != _patchID) return false;
+    };
+
+    return true;
+}
+
+void Si4735::beginTransaction(void){
+    if(_arbiter) _arbiter->acquire(this);
+    if(!_i2caddr) {
+#if !defined(SI4735_NOSPI)
+        //Datahseet says Si4735 can't do more than 2.5MHz on SPI and if you're
+        //level shifting through a BOB-08745, you can't do more than 250kHz.
+        //SCLK idles LOW, SDIO is sampled on RISING edge and datasheet says 
+        //Si4735 is big endian (MSB first).
+        //Someone else may have used the bus since our last transaction, so 
+        //(re)apply all of that every time.
+# if defined(SPI_HAS_TRANSACTION)
+        SPI.beginTransaction(SPISettings((_slowshifter ? 250000 : 2000000),
+                                         MSBFIRST, SPI_MODE0));
+# else
+        SPI.setClockDivider((_slowshifter ? SPI_CLOCK_DIV64 : 
+                             SPI_CLOCK_DIV8));
+        SPI.setDataMode(SPI_MODE0);
+        SPI.setBitOrder(MSBFIRST);
+# endif
+        digitalWrite(_pinSEN, LOW);
+        //Datasheet calls for 30ns, Arduino can only go as low as 3us
+        delayMicroseconds(5);
+#endif
+    };
+}
+
+void Si4735::endTransaction(void){
+    if(!_i2caddr) {
+#if !defined(SI4735_NOSPI)
+        //Datahseet calls for 5ns, Arduino can only go as low as 3us
+        delayMicroseconds(5);
+        digitalWrite(_pinSEN, HIGH);
+# if defined(SPI_HAS_TRANSACTION)
+        SPI.endTransaction();
+# endif
+#endif
+    };
+    if(_arbiter) _arbiter->release(this);
+}
+
+void Si4735::enableInterrupts(void){
+    //Enable end-of-seek, RDS and (if asked for) RSQ interrupts
+    //TODO: write interrupt handlers for STCINT and RDSINT
+    setProperty(
+        SI4735_PROP_GPO_IEN, 
+        word(0x00, ((_mode == SI4735_MODE_FM) ? SI4735_FLG_RDSIEN : 0x00) | 
+             (_rsqsources ? SI4735_FLG_RSQIEN : 0x00) | SI4735_FLG_STCIEN));
+}
+
 void Si4735::waitForInterrupt(byte which){
     while(!(getStatus() & which)){
         //Balance being snappy with hogging the chip
         delay(125);
-        sendCommand(SI4735_CMD_GET_INT_STATUS);
+        //A chip the watchdog couldn't bring back won't raise it either
+        if(sendCommand(SI4735_CMD_GET_INT_STATUS) & SI4735_STATUS_ERR) break;
     }
 }
+
+Si4735Manager::Si4735Manager(){
+    _tuners = 0;
+    _pollInterval = 10;
+    _onStation = NULL;
+    _created = millis();
+}
+
+byte Si4735Manager::addTuner(Si4735* tuner, Si4735RDSDecoder* decoder){
+    Slot* slot;
+
+    if(_tuners == SI4735_MANAGER_TUNERS) return 0xFF;
+
+    slot = &_slots[_tuners];
+    memset((void *)slot, 0x00, sizeof(Slot));
+    slot->tuner = tuner;
+    slot->decoder = decoder;
+
+    return _tuners++;
+}
+
+bool Si4735Manager::enqueue(byte tuner, byte type, word from, word to){
+    Slot* slot;
+    Job* job;
+
+    if(tuner >= _tuners) return false;
+    slot = &_slots[tuner];
+    if(slot->count == SI4735_MANAGER_QUEUE) return false;
+
+    job = &slot->queue[(slot->head + slot->count) % SI4735_MANAGER_QUEUE];
+    job->type = type;
+    job->from = from;
+    job->to = to;
+    slot->count++;
+
+    return true;
+}
+
+byte Si4735Manager::getQueueLength(byte tuner){
+    return (tuner < _tuners) ? _slots[tuner].count : 0;
+}
+
+bool Si4735Manager::isIdle(void){
+    for(byte i = 0; i < _tuners; i++)
+        if(_slots[i].count) return false;
+
+    return true;
+}
+
+void Si4735Manager::pump(void){
+    Slot* slot;
+    word block[4];
+
+    for(byte i = 0; i < _tuners; i++) {
+        slot = &_slots[i];
+        if(slot->running) {
+            //The chip is doing the work, just check on it once in a while
+            if(millis() - slot->polled < _pollInterval) continue;
+            slot->polled = millis();
+            slot->stats.stcPolls++;
+            if(!slot->tuner->isSeekTuneComplete()) continue;
+            slot->stats.busyTime += millis() - slot->started;
+            if(!completeJob(i, slot)) continue;
+            slot->running = false;
+            slot->head = (slot->head + 1) % SI4735_MANAGER_QUEUE;
+            slot->count--;
+            slot->stats.jobs++;
+        }
+
+        //Idle tuners get their RDS FIFO drained and then the next job
+        if(slot->tuner->getMode() == SI4735_MODE_FM) {
+            slot->tuner->sendCommand(SI4735_CMD_GET_INT_STATUS);
+            while(slot->tuner->readRDSBlock(block)) {
+                slot->stats.rdsGroups++;
+                if(slot->decoder) slot->decoder->decodeRDSBlock(block);
+            }
+        }
+        if(slot->count) startJob(slot);
+    }
+}
+
+void Si4735Manager::getStats(byte tuner, Si4735_Manager_Stats* stats){
+    if(tuner < _tuners) *stats = _slots[tuner].stats;
+}
+
+unsigned long Si4735Manager::getTotals(Si4735_Manager_Stats* stats){
+    memset((void *)stats, 0x00, sizeof(Si4735_Manager_Stats));
+    for(byte i = 0; i < _tuners; i++) {
+        stats->jobs += _slots[i].stats.jobs;
+        stats->tunes += _slots[i].stats.tunes;
+        stats->seeks += _slots[i].stats.seeks;
+        stats->stations += _slots[i].stats.stations;
+        stats->rdsGroups += _slots[i].stats.rdsGroups;
+        stats->stcPolls += _slots[i].stats.stcPolls;
+        stats->busyTime += _slots[i].stats.busyTime;
+    }
+
+    return millis() - _created;
+}
+
+void Si4735Manager::startJob(Slot* slot){
+    Job* job;
+
+    job = &slot->queue[slot->head];
+    switch(job->type){
+        case SI4735_JOB_TUNE:
+        case SI4735_JOB_SCAN:
+            slot->scanning = false;
+            slot->tuner->startTune(job->from);
+            slot->stats.tunes++;
+            break;
+        case SI4735_JOB_SEEK_UP:
+        case SI4735_JOB_SEEK_DOWN:
+            slot->tuner->startSeek(job->type == SI4735_JOB_SEEK_UP);
+            slot->stats.seeks++;
+            break;
+    }
+    slot->running = true;
+    slot->started = slot->polled = millis();
+}
+
+bool Si4735Manager::completeJob(byte tuner, Slot* slot){
+    Job* job;
+    word frequency;
+    bool valid;
+
+    job = &slot->queue[slot->head];
+    //This also acknowledges STCINT
+    frequency = slot->tuner->getFrequency(&valid);
+    switch(job->type){
+        case SI4735_JOB_TUNE:
+            return true;
+        case SI4735_JOB_SEEK_UP:
+        case SI4735_JOB_SEEK_DOWN:
+            break;
+        case SI4735_JOB_SCAN:
+            //Past the end of our segment or stopped at the band limit
+            if(frequency > job->to ||
+               (slot->scanning && (frequency <= slot->last || !valid)))
+                return true;
+            break;
+    }
+    if(valid) {
+        slot->stats.stations++;
+        if(_onStation) _onStation(tuner, frequency);
+    }
+    if(job->type != SI4735_JOB_SCAN) return true;
+
+    //Scans go on with a non-wrapping seek from where we are
+    slot->scanning = true;
+    slot->last = frequency;
+    slot->tuner->startSeek(true, false);
+    slot->stats.seeks++;
+    slot->started = slot->polled = millis();
+
+    return false;
+}
+
+Si4735CommandQueue::Si4735CommandQueue(Si4735* tuner){
+    _tuner = tuner;
+    _head = 0;
+    _count = 0;
+    _inflight = false;
+    _retried = false;
+    _sent = 0;
+    _merged = 0;
+    _started = 0;
+}
+
+bool Si4735CommandQueue::enqueue(byte command, byte arg1, byte arg2, 
+                                 byte arg3, byte arg4, byte arg5, byte arg6,
+                                 byte arg7, byte* response,
+                                 void (*callback)(byte status, 
+                                                  byte* response)){
+    Entry* entry;
+
+    if(_count == SI4735_COMMAND_QUEUE) return false;
+
+    entry = &_queue[(_head + _count) % SI4735_COMMAND_QUEUE];
+    entry->command = command;
+    entry->args[0] = arg1;
+    entry->args[1] = arg2;
+    entry->args[2] = arg3;
+    entry->args[3] = arg4;
+    entry->args[4] = arg5;
+    entry->args[5] = arg6;
+    entry->args[6] = arg7;
+    entry->response = response;
+    entry->callback = callback;
+    _count++;
+
+    return true;
+}
+
+bool Si4735CommandQueue::enqueueProperty(word property, word value,
+                                         void (*callback)(byte status,
+                                                          byte* response)){
+    Entry* entry;
+
+    //Walk back over the queued property writes, stopping at anything else
+    //(the write must still happen before it) or at the command in flight
+    for(byte i = _count; i > (_inflight ? 1 : 0); i--) {
+        entry = &_queue[(_head + i - 1) % SI4735_COMMAND_QUEUE];
+        if(entry->command != SI4735_CMD_SET_PROPERTY) break;
+        if(word(entry->args[1], entry->args[2]) == property) {
+            //Somebody is waiting on that exact write, leave it alone
+            if(entry->callback) break;
+            entry->args[3] = highByte(value);
+            entry->args[4] = lowByte(value);
+            entry->callback = callback;
+            _merged++;
+            return true;
+        }
+    }
+
+    return enqueue(SI4735_CMD_SET_PROPERTY, 0x00, highByte(property),
+                   lowByte(property), highByte(value), lowByte(value), 0x00,
+                   0x00, NULL, callback);
+}
+
+bool Si4735CommandQueue::pump(void){
+    Entry* entry;
+    byte status;
+
+    if(_inflight) {
+        status = _tuner->getStatus();
+        if(!(status & SI4735_STATUS_CTS) && (!_tuner->_watchdogTimeout ||
+           millis() - _started < _tuner->_watchdogTimeout)) return true;
+        entry = &_queue[_head];
+        _inflight = false;
+        //Same as sendCommand(): recover and send it once more, then give up
+        if(_tuner->isFaulty(entry->command, status)) {
+            if(!_retried && _tuner->recover()) {
+                //Left at the head, it goes out again below
+                _retried = true;
+                entry = NULL;
+            } else status |= SI4735_STATUS_ERR;
+        };
+        if(entry) {
+            if(entry->response) _tuner->getResponse(entry->response);
+            _retried = false;
+            _head = (_head + 1) % SI4735_COMMAND_QUEUE;
+            _count--;
+            //Called last so that it may queue more commands
+            if(entry->callback) entry->callback(status, entry->response);
+        };
+    }
+    if(_count) {
+        entry = &_queue[_head];
+        //The chip keeps it from now on, so must recover() and getSnapshot()
+        if(entry->command == SI4735_CMD_SET_PROPERTY)
+            _tuner->cacheProperty(word(entry->args[1], entry->args[2]),
+                                  word(entry->args[3], entry->args[4]));
+        _tuner->startCommand(entry->command, entry->args[0], entry->args[1],
+                             entry->args[2], entry->args[3], entry->args[4],
+                             entry->args[5], entry->args[6]);
+        _started = millis();
+        _inflight = true;
+        _sent++;
+    }
+
+    return _count != 0;
+}
+
+Si4735RDSMonitor::Si4735RDSMonitor(Si4735* tuner, Si4735RDSDecoder* decoder){
+    _tuner = tuner;
+    _decoder = decoder;
+    _running = false;
+    _awake = 0;
+    _latency = 0;
+}
+
+void Si4735RDSMonitor::begin(word frequency, byte events, 
+                             unsigned long period, word window, bool xosc){
+    _frequency = frequency;
+    _events = events;
+    _period = period;
+    _window = window;
+    _xosc = xosc;
+    _awake = 0;
+    _latency = 0;
+    //Wake up at once for the first time
+    _started = millis();
+    _woken = _started - _period;
+    _running = true;
+    _tuner->end(false);
+}
+
+void Si4735RDSMonitor::end(void){
+    if(!_running) return;
+    _running = false;
+    _tuner->setMode(SI4735_MODE_FM, false, _xosc);
+    _tuner->setFrequency(_frequency);
+}
+
+byte Si4735RDSMonitor::pump(void){
+    byte seen, flags;
+    word antcap;
+
+    if(!_running || millis() - _woken < _period) return 0;
+
+    _woken = millis();
+    //The chip is powered down already, no POWER_DOWN needed
+    _tuner->setMode(SI4735_MODE_FM, false, _xosc);
+    //We only need RDS off this station, don't wait for the AFC to settle;
+    //whatever the application tunes next must not be degraded, though
+    flags = _tuner->getTuneOptions(&antcap);
+    _tuner->setTuneOptions(SI4735_FLG_FAST);
+    _tuner->setFrequency(_frequency);
+    _tuner->setTuneOptions(flags, antcap);
+    seen = listen(_woken);
+    _tuner->end(false);
+    _awake += millis() - _woken;
+
+    return seen;
+}
+
+unsigned long Si4735RDSMonitor::getSleepTime(void){
+    if(!_running || millis() - _woken >= _period) return 0;
+
+    return _period - (millis() - _woken);
+}
+
+word Si4735RDSMonitor::getDutyCycle(void){
+    unsigned long total;
+
+    total = millis() - _started;
+    if(!total) return 0;
+
+    //Keep clear of overflowing _awake * 1000 on long runs
+    return (word)((total >= 1000) ? _awake / (total / 1000) :
+                                    _awake * 1000 / total);
+}
+
+byte Si4735RDSMonitor::listen(unsigned long woken){
+    word block[4];
+    byte errors, grouptype, seen, known;
+
+    seen = 0;
+    //Fields we're not watching count as known from the start
+    known = ~_events;
+    _latency = 0;
+    while(millis() - woken < _window) {
+        _tuner->sendCommand(SI4735_CMD_GET_INT_STATUS);
+        if(!_tuner->readRDSBlock(block, &errors)) {
+            delay(5);
+            continue;
+        };
+        if(_decoder) _decoder->decodeRDSBlock(block);
+        //Block B carries everything we're after
+        if(((errors & SI4735_RDS_BLEB_MASK) >> SI4735_RDS_BLEB_SHR) >
+           SI4735_RDS_BLE_12) continue;
+        if(!_latency) _latency = millis() - woken;
+
+        grouptype = lowByte((block[1] & SI4735_RDS_TYPE_MASK) >>
+                            SI4735_RDS_TYPE_SHR);
+        //PTY 31 is Alarm in both RDS and RBDS
+        if(((block[1] & SI4735_RDS_PTY_MASK) >> SI4735_RDS_PTY_SHR) == 31)
+            seen |= SI4735_MONITOR_ALARM;
+        known |= SI4735_MONITOR_ALARM;
+        if(grouptype == SI4735_GROUP_0A || grouptype == SI4735_GROUP_0B ||
+           grouptype == SI4735_GROUP_15B) {
+            if(block[1] & SI4735_RDS_TA) seen |= SI4735_MONITOR_TA;
+            known |= SI4735_MONITOR_TA;
+        };
+        if(grouptype == SI4735_GROUP_4A) {
+            seen |= SI4735_MONITOR_CT;
+            known |= SI4735_MONITOR_CT;
+        };
+        if(known == 0xFF) break;
+    }
+
+    return seen & _events;
+}
+
+#if !defined(SI4735_LINUX)
+Si4735Link::Si4735Link(Si4735* tuner){
+    _tuner = tuner;
+    _stream = NULL;
+    _received = 0;
+    _synced = false;
+    _streams = 0;
+    _events = 0;
+    _rsqInterval = 1000;
+    _frames = 0;
+    _errors = 0;
+    _requestSeq = 0;
+    _requestCRC = 0;
+    _replyType = 0;
+    _replyLength = 0;
+    _haveReply = false;
+}
+
+void Si4735Link::begin(Stream* stream){
+    _stream = stream;
+    _received = 0;
+    _synced = false;
+    _haveReply = false;
+    _rsqSent = _rdsPolled = millis();
+}
+
+void Si4735Link::pump(void){
+    Si4735_RX_Metrics RSQ;
+    byte payload[9], errors, value;
+    word block[4], crc;
+
+    while(_stream->available() > 0) {
+        value = _stream->read();
+        if(!_synced) {
+            _synced = (value == SI4735_LINK_SYNC);
+            _received = 0;
+            continue;
+        };
+        _frame[_received++] = value;
+        //Garbage for a length, hunt for the next SYNC
+        if(_received == 1 && value > SI4735_LINK_PAYLOAD) {
+            _synced = false;
+            _errors++;
+            continue;
+        };
+        if(_received < 3 || _received < 3 + _frame[0] + 2) continue;
+        _synced = false;
+        crc = word(_frame[3 + _frame[0]], _frame[3 + _frame[0] + 1]);
+        if(Si4735_crc16(_frame, 3 + _frame[0]) != crc) {
+            //No NAK, SEQ may be what got corrupted; the host times out
+            _errors++;
+            continue;
+        };
+        _frames++;
+        //The host didn't get our reply and sent the same request again:
+        //running it twice would e.g. seek past a station
+        if(_haveReply && _frame[1] == _requestSeq && crc == _requestCRC) {
+            send(_requestSeq, _replyType, _reply, _replyLength);
+            continue;
+        };
+        _requestSeq = _frame[1];
+        _requestCRC = crc;
+        handleFrame();
+    }
+
+    if((_streams & SI4735_LINK_STREAM_RDS) && millis() - _rdsPolled >= 10) {
+        _rdsPolled = millis();
+        _tuner->sendCommand(SI4735_CMD_GET_INT_STATUS);
+        while(_tuner->readRDSBlock(block, &errors)) {
+            for(byte i = 0; i < 4; i++) {
+                payload[i * 2] = highByte(block[i]);
+                payload[i * 2 + 1] = lowByte(block[i]);
+            }
+            payload[8] = errors;
+            send(_events++, SI4735_LINK_RDS, payload, 9);
+        }
+    };
+    if((_streams & SI4735_LINK_STREAM_RSQ) && 
+       millis() - _rsqSent >= _rsqInterval) {
+        _rsqSent = millis();
+        //A chip that stopped answering has nothing to report this time
+        if(!_tuner->getRSQ(&RSQ)) return;
+        payload[0] = RSQ.RSSI;
+        payload[1] = RSQ.SNR;
+        payload[2] = RSQ.MULT;
+        payload[3] = (byte)RSQ.FREQOFF;
+        payload[4] = RSQ.STBLEND;
+        payload[5] = RSQ.PILOT;
+        send(_events++, SI4735_LINK_RSQ, payload, 6);
+    };
+}
+
+void Si4735Link::handleFrame(void){
+    byte length, type, count, reply[SI4735_LINK_PAYLOAD];
+    byte* payload;
+    word value;
+
+    length = _frame[0];
+    type = _frame[2];
+    payload = &_frame[3];
+    switch(type){
+        case SI4735_LINK_COMMAND:
+            count = length / 8;
+            if(!count || length % 8 || count + 16 > SI4735_LINK_PAYLOAD) break;
+            for(byte i = 0; i < count; i++, payload += 8)
+                reply[i] = _tuner->sendCommand(payload[0], payload[1], 
+                                               payload[2], payload[3],
+                                               payload[4], payload[5],
+                                               payload[6], payload[7]);
+            _tuner->getResponse(&reply[count]);
+            this->reply(type | SI4735_LINK_REPLY, reply, count + 16);
+            return;
+        case SI4735_LINK_GET_PROPERTY:
+            if(length % 2) break;
+            for(byte i = 0; i < length; i += 2) {
+                value = _tuner->getProperty(word(payload[i], payload[i + 1]));
+                reply[i] = highByte(value);
+                reply[i + 1] = lowByte(value);
+            }
+            this->reply(type | SI4735_LINK_REPLY, reply, length);
+            return;
+        case SI4735_LINK_SET_PROPERTY:
+            if(length % 4) break;
+            for(byte i = 0; i < length; i += 4)
+                _tuner->setProperty(word(payload[i], payload[i + 1]),
+                                    word(payload[i + 2], payload[i + 3]));
+            this->reply(type | SI4735_LINK_REPLY, NULL, 0);
+            return;
+        case SI4735_LINK_STREAM:
+            if(length != 3) break;
+            _streams = payload[0];
+            _rsqInterval = word(payload[1], payload[2]);
+            this->reply(type | SI4735_LINK_REPLY, NULL, 0);
+            return;
+        default:
+            reply[0] = SI4735_LINK_NAK_TYPE;
+            this->reply(SI4735_LINK_NAK, reply, 1);
+            return;
+    }
+    reply[0] = SI4735_LINK_NAK_LENGTH;
+    this->reply(SI4735_LINK_NAK, reply, 1);
+}
+
+void Si4735Link::reply(byte type, const byte* payload, byte length){
+    _replyType = type;
+    _replyLength = length;
+    if(length) memcpy(_reply, payload, length);
+    _haveReply = true;
+    send(_requestSeq, type, payload, length);
+}
+
+void Si4735Link::send(byte seq, byte type, const byte* payload, byte length){
+    byte header[3];
+    word crc;
+
+    header[0] = length;
+    header[1] = seq;
+    header[2] = type;
+    crc = Si4735_crc16(header, 3);
+    crc = Si4735_crc16(payload, length, crc);
+    _stream->write(SI4735_LINK_SYNC);
+    _stream->write(header, 3);
+    if(length) _stream->write(payload, length);
+    _stream->write(highByte(crc));
+    _stream->write(lowByte(crc));
+}
+#endif
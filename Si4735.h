@@ -13,6 +13,12 @@
  * #define SI4735_NOI2C or SI4735_NOSPI to exclude I2C or SPI code; please
  * note that selecting an operation mode that has been excluded will result
  * in undefined behaviour.
+ * #define SI4735_LINUX to build the library on a Linux host instead of an
+ * Arduino; this also makes the Linux-only facilities in Si4735-linux.h
+ * available.
+ * Edit SI4735_RDS_CHAR_BYTES and the other sizing defines below in this
+ * file, not from a sketch: the library is compiled on its own and both must
+ * agree on the layout of the structures and classes they size.
  */
 
 #ifndef _SI4735_H_INCLUDED
@@ -22,7 +28,9 @@
    this is thorougly investigated (I see another refactor coming up) */
 #define SI4735_NOI2C
 
-#if defined(ARDUINO) && ARDUINO >= 100
+#if defined(SI4735_LINUX)
+# include "Si4735-host.h"
+#elif defined(ARDUINO) && ARDUINO >= 100
 # include <Arduino.h>  
 #else
 # include <WProgram.h>  
@@ -259,6 +267,160 @@
 #define SI4735_RDS_DI_COMPRESSED 0x04
 #define SI4735_RDS_DI_DYNAMIC_PTY 0x08
 
+//Define Programme Item Number (PIN) fields, see Si4735_RDS_Data
+#define SI4735_RDS_PIN_DAY_MASK 0xF800
+#define SI4735_RDS_PIN_DAY_SHR 11
+#define SI4735_RDS_PIN_HOUR_MASK 0x07C0
+#define SI4735_RDS_PIN_HOUR_SHR 6
+#define SI4735_RDS_PIN_MINUTE_MASK 0x003F
+#define SI4735_RDS_PIN_MINUTE_SHR 0
+
+//List of PI coverage areas, see Si4735Translate::getCoverageArea(). 
+//Regional areas go from SI4735_RDS_AREA_REGIONAL (region 1) to 0x0F 
+//(region 12).
+#define SI4735_RDS_AREA_LOCAL 0x00
+#define SI4735_RDS_AREA_INTERNATIONAL 0x01
+#define SI4735_RDS_AREA_NATIONAL 0x02
+#define SI4735_RDS_AREA_SUPRAREGIONAL 0x03
+#define SI4735_RDS_AREA_REGIONAL 0x04
+
+//Define RDS block error (BLE) fields, as returned by readRDSBlock()
+#define SI4735_RDS_BLEA_MASK 0xC0
+#define SI4735_RDS_BLEA_SHR 6
+#define SI4735_RDS_BLEB_MASK 0x30
+#define SI4735_RDS_BLEB_SHR 4
+#define SI4735_RDS_BLEC_MASK 0x0C
+#define SI4735_RDS_BLEC_SHR 2
+#define SI4735_RDS_BLED_MASK 0x03
+#define SI4735_RDS_BLED_SHR 0
+#define SI4735_RDS_BLE_0 0x00
+#define SI4735_RDS_BLE_12 0x01
+#define SI4735_RDS_BLE_35 0x02
+#define SI4735_RDS_BLE_U 0x03
+
+//Chip default for SI4735_PROP_FM_RDS_CONFIDENCE
+#define SI4735_RDS_CONFIDENCE_DEFAULT 0x1111
+
+//Matches any PTY in a Si4735_RDS_Criteria
+#define SI4735_RDS_PTY_ANY 0xFF
+
+//List of character sets Si4735RDSDecoder can convert RDS text (EBU Latin,
+//IEC 62106 Annex E) to, see setCharset()
+#define SI4735_RDS_CHARSET_ASCII 0
+#define SI4735_RDS_CHARSET_LATIN1 1
+#define SI4735_RDS_CHARSET_UTF8 2
+
+//Define how many bytes one RDS character may take once converted, which
+//sizes the text in Si4735_RDS_Data: UTF-8 needs 3, ASCII and Latin-1 need 1.
+//Each Si4735_RDS_Data costs 240 bytes more at 3 and a Si4735RDSDecoder 
+//holds one, so AVR boards get 1. Change it here, see the top of this file
+#if defined(__AVR__)
+# define SI4735_RDS_CHAR_BYTES 1
+#else
+# define SI4735_RDS_CHAR_BYTES 3
+#endif
+
+//List of signal quality metrics with RSQ interrupt thresholds
+#define SI4735_RSQ_RSSI 0
+#define SI4735_RSQ_SNR 1
+#define SI4735_RSQ_MULT 2
+#define SI4735_RSQ_BLEND 3
+//These two can only be filtered, see Si4735RSQFilter
+#define SI4735_RSQ_FREQOFF 4
+#define SI4735_RSQ_METRICS 5
+
+//Define Si4735RSQHistory sizing, change it here to suit your RAM (see the
+//top of this file)
+#define SI4735_HISTORY_STATIONS 4
+#define SI4735_HISTORY_DEPTH 8
+
+//Define Si4735Manager sizing, change it here to suit your board (see the top
+//of this file)
+#define SI4735_MANAGER_TUNERS 4
+#define SI4735_MANAGER_QUEUE 8
+
+//List of possible jobs for Si4735Manager
+#define SI4735_JOB_TUNE 0
+#define SI4735_JOB_SEEK_UP 1
+#define SI4735_JOB_SEEK_DOWN 2
+#define SI4735_JOB_SCAN 3
+
+//List of events Si4735RDSMonitor can watch for
+#define SI4735_MONITOR_TA 0x01
+#define SI4735_MONITOR_ALARM 0x02
+#define SI4735_MONITOR_CT 0x04
+
+//Define how many channels Si4735::calibrate() samples at most, each one
+//costs 2 bytes of stack
+#if !defined(SI4735_CALIBRATION_SAMPLES)
+# define SI4735_CALIBRATION_SAMPLES 64
+#endif
+
+//Define watchdog defaults: how long (ms) a command may go without CTS, how
+//many commands in a row must fail with ERR before the chip is suspected,
+//how many times recovery is attempted and how many properties are 
+//remembered for it (4 bytes of RAM each); change them here to suit your 
+//board, see the top of this file
+#define SI4735_WATCHDOG_TIMEOUT 250
+#define SI4735_WATCHDOG_ERRORS 2
+#define SI4735_WATCHDOG_RETRIES 3
+#define SI4735_WATCHDOG_PROPERTIES 16
+
+//Define how many points Si4735::calibrateAntcap() measures across a band, 
+//each one costs 2 bytes of RAM in a Si4735_Antcap_Table; change it here (see
+//the top of this file)
+#define SI4735_ANTCAP_POINTS 16
+
+//Define when Si4735RDSClock considers CT stale (CT is sent once a minute)
+//and how long a run of CT it wants before estimating drift, in ms
+#if !defined(SI4735_RDS_CLOCK_STALE)
+# define SI4735_RDS_CLOCK_STALE 180000UL
+#endif
+#if !defined(SI4735_RDS_CLOCK_BASELINE)
+# define SI4735_RDS_CLOCK_BASELINE 600000UL
+#endif
+
+//Define Si4735_Snapshot format version, bump on layout changes
+#define SI4735_SNAPSHOT_VERSION 1
+
+//Si4735Link binary protocol. A frame is SYNC, LEN, SEQ, TYPE, LEN bytes of
+//payload and the CRC-16/CCITT of everything but SYNC. Multi-byte fields are
+//big-endian, like the chip. Replies echo SEQ and have SI4735_LINK_REPLY set
+//in TYPE; events the device sends on its own have TYPE >= SI4735_LINK_RDS.
+#define SI4735_LINK_SYNC 0xA5
+//Payload: up to 8 commands of 8 bytes each, run in order. Reply: the status
+//byte of each, then the response to the last one (16 bytes).
+#define SI4735_LINK_COMMAND 0x01
+//Payload: property numbers. Reply: their values.
+#define SI4735_LINK_GET_PROPERTY 0x02
+//Payload: property number and value pairs. Reply: empty.
+#define SI4735_LINK_SET_PROPERTY 0x03
+//Payload: SI4735_LINK_STREAM_* mask and RSQ interval in ms. Reply: empty.
+#define SI4735_LINK_STREAM 0x04
+#define SI4735_LINK_REPLY 0x40
+//Reply to a frame that couldn't be handled. Payload: SI4735_LINK_NAK_*.
+#define SI4735_LINK_NAK 0x7F
+//Event payload: blocks A to D and the block error fields (9 bytes).
+#define SI4735_LINK_RDS 0x81
+//Event payload: RSSI, SNR, MULT, FREQOFF, STBLEND and PILOT (6 bytes).
+#define SI4735_LINK_RSQ 0x82
+#define SI4735_LINK_STREAM_RDS 0x01
+#define SI4735_LINK_STREAM_RSQ 0x02
+#define SI4735_LINK_NAK_TYPE 0x01
+#define SI4735_LINK_NAK_LENGTH 0x02
+
+//Define the largest Si4735Link payload, change it here to suit your RAM (see
+//the top of this file); both ends of the link must agree
+#define SI4735_LINK_PAYLOAD 64
+
+//Define Si4735CommandQueue sizing, change it here to suit your RAM (see the
+//top of this file)
+#define SI4735_COMMAND_QUEUE 16
+
+//Define RDS capture file format constants
+#define SI4735_CAPTURE_MAGIC "S4RD"
+#define SI4735_CAPTURE_VERSION 1
+
 //This holds the current station reception metrics as given by the chip. See
 //the Si4735 datasheet for a detailed explanation of each member.
 typedef struct {
@@ -270,6 +432,123 @@ typedef struct {
     signed char FREQOFF;
 } Si4735_RX_Metrics;
 
+//This holds the work counters Si4735Manager keeps for each tuner, summed
+//over all tuners by Si4735Manager::getTotals().
+typedef struct {
+    unsigned long jobs;
+    unsigned long tunes;
+    unsigned long seeks;
+    unsigned long stations;
+    unsigned long rdsGroups;
+    unsigned long stcPolls;
+    //Milliseconds spent waiting for STC, i.e. with the chip doing the work
+    unsigned long busyTime;
+} Si4735_Manager_Stats;
+
+//This holds the counters of the Si4735 watchdog, see Si4735::setWatchdog().
+typedef struct {
+    //Commands that never got CTS back, that failed with an ERR the chip 
+    //couldn't account for and that got an all 1s status (nobody driving the
+    //bus), respectively
+    unsigned long hangs;
+    unsigned long errors;
+    unsigned long glitches;
+    //Recoveries run and, of those, the ones that gave up
+    unsigned long recoveries;
+    unsigned long failures;
+    //Property writes that didn't fit the cache and won't be restored
+    unsigned long uncached;
+    //Duration of the last and of the longest recovery, in microseconds
+    unsigned long lastRecovery;
+    unsigned long maxRecovery;
+} Si4735_Watchdog_Stats;
+
+//This holds the antenna tuning capacitor values the chip settled on at 
+//points step apart across a band, see Si4735::calibrateAntcap(); the last
+//point sits on top, which may be less than a step past the one before it,
+//and values in between are interpolated. It is meant to be stored (e.g. in EEPROM) and 
+//handed to Si4735::setAntcapTable() on later runs, which checks it against
+//checksum.
+typedef struct {
+    //Mode it was built in and is used in, SI4735_MODE_AM or SI4735_MODE_LW
+    byte mode;
+    byte points;
+    word bottom, top, step;
+    word value[SI4735_ANTCAP_POINTS];
+    //Average tune time at the points with automatic calibration and with 
+    //the table, in microseconds
+    unsigned long automaticTime, cachedTime;
+    byte checksum;
+} Si4735_Antcap_Table;
+
+//This holds what Si4735::resume() needs to bring the receiver back the way
+//Si4735::end() left it. It is meant to be stored (e.g. in EEPROM) and is 
+//checked against version and checksum; its size depends on 
+//SI4735_WATCHDOG_PROPERTIES.
+typedef struct {
+    //SI4735_SNAPSHOT_VERSION
+    byte version;
+    //See SI4735_MODE_*
+    byte mode;
+    bool xosc;
+    //RDS was configured and the RSQ interrupt sources, respectively
+    bool rds;
+    byte rsqSources;
+    word frequency;
+    //Properties written since POWER_UP (band, volume, mute, RDS and any set
+    //with Si4735::setProperty()), in the order they were first written
+    byte properties;
+    word property[SI4735_WATCHDOG_PROPERTIES];
+    word value[SI4735_WATCHDOG_PROPERTIES];
+    //Station identity as last decoded, PI is 0 if there was none
+    word PI;
+    byte PTY;
+    char programService[9];
+    byte checksum;
+} Si4735_Snapshot;
+
+//This describes one band of the band plan setMode() works from: seek limits
+//and spacing in the units setFrequency() takes, deemphasis (see
+//SI4735_FLG_DEEMPH_*) and whether the band is short wave, which changes the
+//default ANTCAP. See Si4735::setBandPlan().
+typedef struct {
+    word bottom;
+    word top;
+    byte spacing;
+    byte deemphasis;
+    bool SW;
+} Si4735_Band_Plan;
+
+//This holds what Si4735::seekRDS() looks for, a station has to match every
+//criterion that is set.
+typedef struct {
+    //Program Identification, 0 for any
+    word PI;
+    //Program Type, SI4735_RDS_PTY_ANY for any
+    byte PTY;
+    //Require Traffic Program and, on top of that, Traffic Announcement
+    bool TP, TA;
+} Si4735_RDS_Criteria;
+
+//This holds the outcome of Si4735::calibrate(). It is meant to be stored 
+//(e.g. in EEPROM) and handed to Si4735::setCalibration() on later runs, 
+//which checks it against checksum. RSSI in dBuV, SNR in dB.
+typedef struct {
+    //Value for SI4735_PROP_FM_RDS_CONFIDENCE
+    word rdsConfidence;
+    //Mode the calibration was done in, see SI4735_MODE_*
+    byte mode;
+    //Lower quartile of the band, i.e. what an empty channel looks like
+    byte noiseRSSI, noiseSNR;
+    //Seek thresholds, see Si4735::setSeekThresholds()
+    byte seekRSSI, seekSNR;
+    //Number of sampled channels that were well above the noise floor
+    byte stations;
+    //SI4735_FLG_BLETH* bits for SI4735_PROP_FM_RDS_CONFIG
+    byte rdsConfig;
+    byte checksum;
+} Si4735_Calibration;
+
 //This holds time of day as received via RDS. Mimicking struct tm from
 //<time.h> for familiarity.
 //NOTE: RDS does not provide seconds, only guarantees that the minute update
@@ -284,6 +563,9 @@ typedef struct {
     byte tm_mon;
     word tm_year;
     byte tm_wday;
+    //Local time offset from UTC as broadcast, in minutes; the fields above
+    //are UTC unless stated otherwise
+    int tm_offset;
 }  Si4735_RDS_Time;
 
 typedef struct {
@@ -291,11 +573,46 @@ typedef struct {
     word programIdentifier;
     bool TP, TA, MS;
     byte PTY, DICC;    
-    char programService[9];
-    char programTypeName[9];
-    char radioText[65];
+    //Extended Country Code and Language Identification Code (group 1A) and
+    //Programme Item Number (groups 1A/1B, see SI4735_RDS_PIN_*), 0 until
+    //received
+    byte ECC, LIC;
+    word PIN;
+    //Text as converted by Si4735RDSDecoder::setCharset(), NUL-terminated
+    char programService[8 * SI4735_RDS_CHAR_BYTES + 1];
+    char programTypeName[8 * SI4735_RDS_CHAR_BYTES + 1];
+    char radioText[64 * SI4735_RDS_CHAR_BYTES + 1];
 } Si4735_RDS_Data;
 
+//This is the header of an RDS capture file, as written by
+//Si4735RDSRecorder. All multi-byte fields are little-endian.
+typedef struct {
+    char magic[4];
+    uint8_t version;
+    uint8_t recordSize;
+    //Frequency tuned to when the capture was started, see setFrequency()
+    uint16_t frequency;
+    uint32_t reserved[2];
+} Si4735_Capture_Header;
+
+//This is one record of an RDS capture file: the four blocks of a group, the
+//block error fields (see SI4735_RDS_BLE*) and the time of receipt in
+//milliseconds since the capture was started. Fixed-width types keep the
+//layout identical on the Arduino and on the host.
+typedef struct {
+    uint32_t timestamp;
+    uint16_t block[4];
+    uint8_t errors;
+    uint8_t reserved[3];
+} Si4735_Capture_Record;
+
+/*
+* Description:
+*   Returns the CRC-16/CCITT (polynomial 0x1021) of length bytes at data,
+*   continuing from crc. Used by the Si4735Link protocol.
+*/
+word Si4735_crc16(const byte* data, word length, word crc = 0xFFFF);
+
 class Si4735RDSDecoder
 {
     public:
@@ -303,7 +620,11 @@ class Si4735RDSDecoder
         * Description:
         *   Default constructor.
         */
-        Si4735RDSDecoder() { resetRDS(); }
+        Si4735RDSDecoder() { 
+            _charset = SI4735_RDS_CHARSET_ASCII;
+            _onRadioText = NULL;
+            resetRDS(); 
+        }
         
         /*
         * Description:
@@ -329,6 +650,49 @@ class Si4735RDSDecoder
         *             availability and not actual value.
         */
         bool getRDSTime(Si4735_RDS_Time* rdstime = NULL);
+
+        /*
+        * Description:
+        *   Selects the character set PS, PTYN and RadioText are converted to
+        *   in Si4735_RDS_Data, re-converting what was received so far. Text
+        *   is converted as it arrives, so getRDSData() only copies it.
+        *   Characters the character set lacks are transliterated (e.g. "a" 
+        *   for "ă") and unprintable ones are shown as "?". Returns false
+        *   (changing nothing) if the character set doesn't fit in 
+        *   SI4735_RDS_CHAR_BYTES.
+        * Parameters:
+        *   charset - one of SI4735_RDS_CHARSET_*, the default is ASCII.
+        */
+        bool setCharset(byte charset);
+        byte getCharset(void) { return _charset; };
+
+        /*
+        * Description:
+        *   Returns which RadioText segments of the current message have
+        *   arrived (bit n for text address n), and whether all of them up to
+        *   the end of the message (0x0D, or else the full 64 or 32 
+        *   characters) have, respectively.
+        */
+        word getRTSegments(void) { return _rtsegments; };
+        bool isRTComplete(void) { return _rtcomplete; };
+
+        /*
+        * Description:
+        *   Returns a hash of the last complete RadioText message, 0 if none
+        *   came in yet. It only changes when a different message completes,
+        *   so polling it is enough to tell a new message from a repeat.
+        */
+        unsigned long getRTHash(void) { return _rthash; };
+
+        /*
+        * Description:
+        *   Sets the function called once per new complete RadioText message,
+        *   with the text (as in Si4735_RDS_Data) and its hash.
+        */
+        void setRTCallback(void (*callback)(const char* text, 
+                                            unsigned long hash)) {
+            _onRadioText = callback;
+        };
         
         /*
         * Description:
@@ -336,6 +700,16 @@ class Si4735RDSDecoder
         *   station.
         */
         void resetRDS(void);
+
+        /*
+        * Description:
+        *   Copies the station identity (PI, PTY and PS) into snapshot and
+        *   presets it from snapshot, respectively. The latter lets the 
+        *   identity show right after Si4735::resume(), until the station's
+        *   own RDS replaces it.
+        */
+        void getIdentity(Si4735_Snapshot* snapshot);
+        void setIdentity(const Si4735_Snapshot* snapshot);
         
 #if defined(SI4735_DEBUG)
         /* Description:
@@ -347,19 +721,43 @@ class Si4735RDSDecoder
     private:
         Si4735_RDS_Data _status;
         Si4735_RDS_Time _time;
+        //PS, PTYN and RadioText as received, in EBU Latin
+        char _ps[8], _ptyn[8], _rt[64];
+        byte _charset;
         bool _rdstextab, _rdsptynab, _havect;
+        word _rtsegments;
+        bool _rtcomplete;
+        unsigned long _rthash;
+        void (*_onRadioText)(const char* text, unsigned long hash);
 #if defined(SI4735_DEBUG)
         word _rdsstats[32];
 #endif
         /*
         * Description:
-        *   Filters the string str in place to only contain printable 
-        *   characters and also replaces 0x0D (CR) with 0x00 effectively
-        *   ending the string at that point as per RDBS §3.1.5.3.
-        *   Any unprintable character is converted to a question mark ("?"),
-        *   as is customary. This helps with filtering out noisy strings.
+        *   Stores length characters at offset into the received text raw
+        *   and, if that changed it, converts raw (size characters) into 
+        *   text and returns true.
+        */
+        bool updateText(char* raw, byte size, byte offset, const char* chars,
+                        byte length, char* text);
+
+        /*
+        * Description:
+        *   Converts length EBU Latin characters at raw into text, in the
+        *   selected character set, NUL-terminated. 0x0D (CR) ends the text
+        *   as per RDBS §3.1.5.3. Any unprintable character is converted to
+        *   a question mark ("?"), as is customary. This helps with filtering
+        *   out noisy strings.
+        */
+        void convertText(const char* raw, byte length, char* text);
+
+        /*
+        * Description:
+        *   Checks whether the current RadioText message, in segments of 
+        *   width characters, is complete and if so, and it's not the one 
+        *   announced last, announces it.
         */
-        void makePrintable(char* str);
+        void checkRadioText(byte width);
 
         /*
         * Description:
@@ -372,330 +770,1612 @@ class Si4735RDSDecoder
         inline word switchEndian(word value) { return (value >> 8) | (value << 8); }
 };
 
-class Si4735Translate
+//A clock set by RDS CT (group 4A) and kept going by millis() in between:
+//each CT is stamped with the millis() it arrived at, so that queries are a
+//handful of arithmetic operations and never touch the chip. Seconds are 
+//interpolated (CT arrives as the minute starts), the drift of millis() 
+//against CT is measured and corrected for, and a CT that disagrees with the
+//clock by more than a minute and a half (e.g. another station) restarts it.
+class Si4735RDSClock
 {
     public:
         /*
         * Description:
-        *   Translates the given PTY into human-readable text for the given
-        *   locale. At most textsize-1 characters will be copied to the buffer
-        *   at text.
+        *   Default constructor.
         */
-        void getTextForPTY(byte PTY, byte locale, char* text, byte textsize);
-        
+        Si4735RDSClock() { reset(); };
+
         /*
         * Description:
-        *   Translates the given PTY between the given locales.
+        *   Looks at one RDS group, as given to 
+        *   Si4735RDSDecoder::decodeRDSBlock(), right after it was received;
+        *   only 4A groups carrying CT are used. Returns true if the clock 
+        *   was set.
+        * Parameters:
+        *   block - the four blocks of the group.
+        *   now   - millis() when the group was received, if not just now.
         */
-        byte translatePTY(byte PTY, byte fromlocale, byte tolocale);
-        
+        bool decodeRDSBlock(const word block[]) {
+            return decodeRDSBlock(block, millis());
+        };
+        bool decodeRDSBlock(const word block[], unsigned long now);
+
         /*
         * Description:
-        *   Decodes the station callsign out of the PI using the method
-        *   defined in the RDBS standard for North America.
-        * Parameters:
-        *   programIdentifier - a word containing the Program Identifier value
-        *                       from RDS
-        *   callSign - pointer to a char[] at least 5 characters long that 
-        *              receives the decoded station call sign
+        *   Forgets everything, e.g. when switching to a new station.
         */
-        void decodeCallSign(word programIdentifier, char* callSign);
-};
+        void reset(void);
 
-class Si4735
-{
-    public:
         /*
         * Description:
-        *   This the constructor. It assumes SparkFun Si4735 Shield + level
-        *   shifter (or the diode fix, or 3.3V-native Arduino) semantics if
-        *   called without parameters.
-        *   If you're not using the Shield (e.g. using the Breakout Board) or
-        *   have wired the Si4735 differently, then explicitly supply the
-        *   constructor with the actual pin numbers.
-        *   Use the hardwired pins constants above to tell the constructor you
-        *   haven't used (and hardwired) some of the pins.
-        * Parameters:
-        *   interface - interface and protocol used to talk to the chip 
-        *   pin*      - pin numbers for connections to the Si4735, with
-        *               defaults for the SparkFun Si4735 Shield already
-        *               provided.
+        *   Returns the current time in seconds since 1970-01-01 00:00:00 UTC
+        *   and the same in local time (per the offset the station sends),
+        *   respectively; 0 until the first CT.
         */
-        Si4735(byte interface = SI4735_INTERFACE_SPI, 
-               byte pinPower = SI4735_PIN_POWER,
-               byte pinReset = SI4735_PIN_RESET,
-               byte pinGPO2 = SI4735_PIN_GPO2, byte pinSEN = SI4735_PIN_SEN);
-        
+        unsigned long getUTC(void);
+        unsigned long getLocal(void) {
+            return (_valid ? getUTC() + (long)_offset * 60 : 0);
+        };
+
         /*
         * Description:
-        *   This is the destructor, it shuts the Si4735 down
+        *   Fills time and, if not NULL, second with the current time, local
+        *   or UTC. Returns false (touching neither) until the first CT.
         */
-        ~Si4735() { end(true); };
-        
+        bool getTime(Si4735_RDS_Time* time, byte* second = NULL, 
+                     bool local = true);
+
         /*
-        * Description: 
-        *   Initializes the Si4735, powers up the radio in the desired mode 
-        *   and limits the bandwidth appropriately.
-        *   This function must be called before any other radio command.
-        *   The band limits are set as follows:
-        *     LW - 152 to 279 kHz
-        *     AM - 520 to 1710 kHz
-        *     SW - 2.3 to 23 MHz
-        *     FM - 87.5 to 107.9 MHz
-        * Parameters:
-        *   mode        - The desired radio mode, one of the SI4735_MODE_*
-        *                 constants.
-        *   xosc        - A 32768Hz external oscillator is present.
-        *   slowshifter - A BOB-08745 is used for level shifting between an
-        *                 Uno/Mega and the Si4735. Use a 3.3V I/O Arduino or
-        *                 shift through a BOB-10403 to be able to go up to
-        *                 1MHz by setting this to false.
+        * Description:
+        *   Returns the local time offset from UTC the station sends, in 
+        *   minutes.
         */
-        void begin(byte mode, bool xosc = true, bool slowshifter = true);
-        
+        int getOffset(void) { return _offset; };
+
         /*
-        * Description: 
-        *   Used to send a command and its arguments to the radio chip.
-        * Parameters:
-        *   command - the command byte, see datasheet and use one of the
-                      SI4735_CMD_* constants
-        *   arg1-7  - command arguments, see the Si4735 Programmers Guide.
+        * Description:
+        *   Returns how fast millis() runs against CT, in parts per million
+        *   (positive is fast); 0 until CT has been received for 
+        *   SI4735_RDS_CLOCK_BASELINE. CT is only good to about a second, so
+        *   this gets better the longer CT keeps coming.
         */
-        void sendCommand(byte command, byte arg1 = 0, byte arg2 = 0,
-                         byte arg3 = 0, byte arg4 = 0, byte arg5 = 0,
-                         byte arg6 = 0, byte arg7 = 0);
+        long getDrift(void) { return _drift; };
 
         /*
-        * Description: 
-        *   Acquires certain revision parameters from the Si4735 chip, returns
-        *   the last two digits of the chip part number (e.g. 35 for Si4735).
-        * Parameters:
-        *   FW  - Firmware Version and it is a 2 character string
-        *   CMP - Component Revision and it is a 2 character string
-        *   REV - Chip Die Revision and it is a single character
-        *   Set to NULL (or ignore) whichever parameter you don't care about.
-        * Chips are usually referred in datasheets as "Si4735-$REV$FW", for
-        * example "Si4735-C40" for the chip on the Sparkfun Shield.
+        * Description:
+        *   Returns the time since the last CT, in ms, and whether that is
+        *   more than SI4735_RDS_CLOCK_STALE, respectively. A stale clock 
+        *   keeps going, only less trustworthy.
         */
-        byte getRevision(char* FW = NULL, char* CMP = NULL, char* REV = NULL,
-                         word* patch = NULL);
+        unsigned long getAge(void) { return millis() - _stamp; };
+        bool isStale(void) {
+            return !_valid || getAge() > SI4735_RDS_CLOCK_STALE;
+        };
 
         /*
-        * Description: 
-        *   Used to to tune the radio to a desired frequency. The library uses
-        *   the mode indicated via begin() to determine how to set the 
-        *   frequency.
-        * Parameters:
-        *   frequency - The frequency to tune to, in kHz (or in 10kHz if using
-        *               FM mode).
+        * Description:
+        *   Returns the number of CT received and of those that restarted 
+        *   the clock, respectively.
         */
-        void setFrequency(word frequency);
+        unsigned long getUpdates(void) { return _updates; };
+        unsigned long getJumps(void) { return _jumps; };
+
+    private:
+        //UTC at _stamp and at _refStamp, the start of the current run of 
+        //agreeing CT, which drift is measured over
+        unsigned long _base, _stamp, _refBase, _refStamp;
+        unsigned long _updates, _jumps;
+        long _drift;
+        int _offset;
+        bool _valid;
 
         /*
         * Description:
-        *   Gets the frequency the chip is currently tuned to.    
-        * Parameters:
-        *   valid - will be set to true if the chip currently detects a valid
-        *           (as defined by current Seek/Tune criteria, see
-        *           FM_SEEK_TUNE_* properties in the datasheet) signal on this
-        *           frequency. Omit if you don't care.
+        *   Returns UTC at millis() now, drift corrected.
         */
-        word getFrequency(bool* valid = NULL);
+        unsigned long getUTC(unsigned long now);
+};
 
+class Si4735RDSRecorder
+{
+    public:
         /*
         * Description:
-        *   Commands the radio to seek up to the next valid channel.
+        *   Default constructor.
+        */
+        Si4735RDSRecorder() { _sink = NULL; _records = 0; }
+
+        /*
+        * Description:
+        *   Starts a new capture by writing the file header to sink.
         * Parameters:
-        *   wrap - set to true to allow the seek to wrap around the current
-        *          band.
+        *   sink      - where to write the capture to, e.g. an open SD File;
+        *               NULL writes nothing and makes record() do nothing.
+        *   frequency - frequency currently tuned to, recorded in the header.
         */
-        void seekUp(bool wrap = true);
+        void begin(Print* sink, word frequency = 0);
 
         /*
         * Description:
-        *   Commands the radio to seek down to the next valid channel.
+        *   Appends one RDS group to the capture, time-stamped with the time
+        *   elapsed since begin(). Call right after a successful 
+        *   Si4735::readRDSBlock().
         * Parameters:
-        *   wrap - set to true to allow the seek to wrap around the current
-        *          band.
+        *   block  - the four RDS blocks, as filled by readRDSBlock().
+        *   errors - the block error fields, as filled by readRDSBlock().
         */
-        void seekDown(bool wrap = true);
-        
+        void record(word block[], byte errors);
+
         /*
         * Description:
-        *   Adjust the threshold levels of the seek function.
-        *   FM Ranges:
-        *     SNR = [0-127] in dB, default = 3dB
-        *     RSSI = [0-127] in dBuV, default = 20dBuV
-        *   AM Ranges:
-        *     SNR = [0-63] in dB, default = 5dB
-        *     RSSI = [0-63] in dBuV, default = 19dBuV
-        */    
-        void setSeekThresholds(byte SNR, byte RSSI);
+        *   Returns the number of groups recorded since begin().
+        */
+        unsigned long getRecordCount(void) { return _records; };
+
+    private:
+        Print* _sink;
+        unsigned long _start, _records;
 
         /*
         * Description:
-        *   If in FM mode and the chip has received any RDS block, fetch it
-        *   off the chip and fill word block[4] with it, returning true;
-        *   otherwise return false without side-effects.
-        *   This function needs to be actively called (e.g. from loop()) in
-        *   order to see sensible information.
+        *   Writes value to the sink in little-endian byte order.
         */
-        bool readRDSBlock(word* block);
+        void writeLE(uint32_t value, byte size);
+};
 
+class Si4735RSQFilter
+{
+    public:
         /*
         * Description:
-        *   Returns true if at least one RDS group has been received while
-        *   tuned into the current station.
+        *   Default constructor.
+        * Parameters:
+        *   shift - smoothing of the moving averages: each new sample counts
+        *           for 1/2^shift of the average, e.g. 3 -> 1/8.
         */
-        bool isRDSCapable(void) { return _haverds; };
+        Si4735RSQFilter(byte shift = 3) { _shift = shift; reset(); }
 
         /*
         * Description:
-        *   Retrieves the Received Signal Quality metrics using a 
-        *   Si4735_RX_Metrics struct.
+        *   Folds one sample, as returned by Si4735::getRSQ() or 
+        *   Si4735::getRSQEvents(), into the statistics of every metric.
+        *   Integer-only and O(1), cheap enough for every RSQ interrupt.
+        * Parameters:
+        *   RSQ - the sample.
+        *   FM  - set to false for AM/SW/LW samples, whose FM-only metrics 
+        *         (MULT, FREQOFF and STBLEND) are then left alone.
         */
-        void getRSQ(Si4735_RX_Metrics* RSQ);
+        void update(const Si4735_RX_Metrics* RSQ, bool FM = true);
 
         /*
         * Description:
-        *   Sets the volume. Valid values are [0-63]. 
+        *   Forgets all samples, use when tuning to a new station.
         */
-        void setVolume(byte value) {
-            setProperty(SI4735_PROP_RX_VOLUME, 
-                        word(0x00, constrain(value, 0, 63)));
-        };
+        void reset(void);
 
         /*
         * Description:
-        *   Gets the current volume.
+        *   Return the statistics of metric (one of the SI4735_RSQ_*
+        *   constants; BLEND stands for STBLEND) over the samples so far:
+        *   the exponential moving average (rounded, or in 1/256 units for
+        *   the Q8 version), its variance (in squared metric units), the
+        *   smallest and largest sample and the sample count.
         */
-        byte getVolume(void) {
-            return lowByte(getProperty(SI4735_PROP_RX_VOLUME));
+        int getAverage(byte metric) {
+            return (_average[metric] + 0x80) >> 8;
         };
+        long getAverageQ8(byte metric) { return _average[metric]; };
+        long getVariance(byte metric) { return _variance[metric] >> 8; };
+        int getMin(byte metric) { return _min[metric]; };
+        int getMax(byte metric) { return _max[metric]; };
+        unsigned long getCount(byte metric) { return _count[metric]; };
+
+    private:
+        byte _shift;
+        //Averages and variances are kept in Q8 fixed point
+        long _average[SI4735_RSQ_METRICS], _variance[SI4735_RSQ_METRICS];
+        int _min[SI4735_RSQ_METRICS], _max[SI4735_RSQ_METRICS];
+        unsigned long _count[SI4735_RSQ_METRICS];
 
         /*
         * Description:
-        *   Increase the volume by 1. If the maximum volume has been 
-        *   reached, no further increase will take place and returns false;
-        *   otherwise true.
+        *   Folds value into the statistics of metric.
         */
-        bool volumeUp(void);
-        
+        void updateMetric(byte metric, int value);
+};
+
+class Si4735RSQHistory
+{
+    public:
         /*
         * Description:
-        *   Decrease the volume by 1. If the minimum volume has been 
-        *   reached, no further decrease will take place and returns false;
-        *   otherwise true.
-        * Parameters:
+        *   Default constructor.
+        */
+        Si4735RSQHistory() { reset(); }
+
+        /*
+        * Description:
+        *   Records one sample for the station on frequency. Up to 
+        *   SI4735_HISTORY_STATIONS stations are tracked, the one updated
+        *   least recently making room for a new one; each keeps its last
+        *   SI4735_HISTORY_DEPTH samples.
+        */
+        void add(word frequency, const Si4735_RX_Metrics* RSQ);
+
+        /*
+        * Description:
+        *   Returns the number of samples held for the station on frequency.
+        */
+        byte getCount(word frequency);
+
+        /*
+        * Description:
+        *   Fills RSQ with a sample of the station on frequency, age 0 being
+        *   the newest, and returns true; returns false if there's no such
+        *   sample.
+        */
+        bool getSample(word frequency, byte age, Si4735_RX_Metrics* RSQ);
+
+        /*
+        * Description:
+        *   Returns how much metric (one of the SI4735_RSQ_* constants) of the
+        *   station on frequency changed from the oldest to the newest sample
+        *   held: positive means improving for RSSI and SNR, 0 if fewer than
+        *   two samples are held.
+        */
+        int getTrend(word frequency, byte metric);
+
+        /*
+        * Description:
+        *   Forgets all stations.
+        */
+        void reset(void);
+
+    private:
+        typedef struct {
+            word frequency;
+            byte head, count;
+            unsigned long used;
+            Si4735_RX_Metrics samples[SI4735_HISTORY_DEPTH];
+        } Station;
+
+        Station _stations[SI4735_HISTORY_STATIONS];
+        unsigned long _clock;
+
+        /*
+        * Description:
+        *   Returns the station on frequency, or NULL if not tracked.
+        */
+        Station* findStation(word frequency);
+
+        /*
+        * Description:
+        *   Returns metric out of RSQ.
+        */
+        int getMetric(const Si4735_RX_Metrics* RSQ, byte metric);
+};
+
+class Si4735Translate
+{
+    public:
+        /*
+        * Description:
+        *   Translates the given PTY into human-readable text for the given
+        *   locale. At most textsize-1 characters will be copied to the buffer
+        *   at text.
+        */
+        void getTextForPTY(byte PTY, byte locale, char* text, byte textsize);
+        
+        /*
+        * Description:
+        *   Translates the given PTY between the given locales.
+        */
+        byte translatePTY(byte PTY, byte fromlocale, byte tolocale);
+        
+        /*
+        * Description:
+        *   Decodes the station callsign out of the PI using the method
+        *   defined in the RDBS standard for North America. Elsewhere PI is
+        *   a country, coverage area and program reference instead, see 
+        *   below.
+        * Parameters:
+        *   programIdentifier - a word containing the Program Identifier value
+        *                       from RDS
+        *   callSign - pointer to a char[] at least 5 characters long that 
+        *              receives the decoded station call sign
+        */
+        void decodeCallSign(word programIdentifier, char* callSign);
+
+        /*
+        * Description:
+        *   Looks up the country a station is in from the country code in 
+        *   its PI and its ECC, as allocated in IEC 62106 Annex D, and fills
+        *   country with its ISO 3166 code (e.g. "DE"). Returns false (and 
+        *   leaves country alone) if ECC hasn't been received or the pair is
+        *   not allocated: the PI country code alone is ambiguous.
+        * Parameters:
+        *   programIdentifier - PI, as in Si4735_RDS_Data
+        *   ECC - Extended Country Code, as in Si4735_RDS_Data
+        *   country - pointer to a char[] at least 3 characters long
+        */
+        bool getCountry(word programIdentifier, byte ECC, char* country);
+
+        /*
+        * Description:
+        *   Fills language with the ISO 639 code (e.g. "en") for the given
+        *   Language Identification Code. Returns false (and leaves language
+        *   alone) if LIC is unknown or not allocated.
+        * Parameters:
+        *   LIC - Language Identification Code, as in Si4735_RDS_Data
+        *   language - pointer to a char[] at least 3 characters long
+        */
+        bool getLanguage(byte LIC, char* language);
+
+        /*
+        * Description:
+        *   Returns the coverage area (one of SI4735_RDS_AREA_*) and the
+        *   program reference number out of PI, respectively. Neither means
+        *   anything for North American (callsign) PIs.
+        */
+        byte getCoverageArea(word programIdentifier) {
+            return (programIdentifier >> 8) & 0x0F;
+        };
+        byte getProgramReference(word programIdentifier) {
+            return lowByte(programIdentifier);
+        };
+};
+
+#if defined(SI4735_LINUX)
+//This is how the chip is talked to on a Linux host, see Si4735I2CDev and
+//Si4735SPIDev in Si4735-linux.h and Si4735::setTransport().
+class Si4735Transport
+{
+    public:
+        virtual ~Si4735Transport() {};
+
+        /*
+        * Description:
+        *   Sends command, an opcode followed by its 7 arguments, to the chip.
+        */
+        virtual void write(const byte* command) = 0;
+
+        /*
+        * Description:
+        *   Reads length bytes (1 for the status byte alone, 16 for the full
+        *   response) off the chip into response.
+        */
+        virtual void read(byte* response, byte length) = 0;
+
+        /*
+        * Description:
+        *   Sends command and reads back the status byte, in the same 
+        *   transaction if the bus allows it, and returns the status byte.
+        */
+        virtual byte writeRead(const byte* command) {
+            byte status;
+
+            write(command);
+            read(&status, 1);
+            return status;
+        };
+};
+#endif
+
+class Si4735BusArbiter
+{
+    public:
+        /*
+        * Description:
+        *   Default constructor.
+        */
+        Si4735BusArbiter() { _owner = NULL; _depth = 0; resetStats(); }
+
+        /*
+        * Description:
+        *   Takes the bus for owner if it is free (or already owned by owner,
+        *   acquisitions nest) and returns true; otherwise returns false 
+        *   right away.
+        * Parameters:
+        *   owner - any pointer unique to the device using the bus, e.g. the
+        *           address of its driver object.
+        */
+        bool tryAcquire(const void* owner);
+
+        /*
+        * Description:
+        *   Takes the bus for owner, yield()-ing for as long as someone else
+        *   holds it. The time spent waiting is accounted for in the
+        *   contention statistics below.
+        */
+        void acquire(const void* owner);
+
+        /*
+        * Description:
+        *   Gives the bus back, once per successful (try)acquire() by owner.
+        */
+        void release(const void* owner);
+
+        /*
+        * Description:
+        *   Returns true if someone holds the bus.
+        */
+        bool isBusy(void) { return _owner != NULL; };
+
+        /*
+        * Description:
+        *   Return the number of times the bus was acquired, the number of
+        *   times acquire() had to wait for it, the total time spent waiting
+        *   and the longest single wait (both in microseconds).
+        */
+        unsigned long getAcquisitions(void) { return _acquisitions; };
+        unsigned long getContentions(void) { return _contentions; };
+        unsigned long getWaitTime(void) { return _waitTime; };
+        unsigned long getMaxWait(void) { return _maxWait; };
+
+        /*
+        * Description:
+        *   Zeroes the contention statistics.
+        */
+        void resetStats(void);
+
+    private:
+        const void* volatile _owner;
+        byte _depth;
+        unsigned long _acquisitions, _contentions, _waitTime, _maxWait;
+};
+
+class Si4735
+{
+    public:
+        /*
+        * Description:
+        *   This the constructor. It assumes SparkFun Si4735 Shield + level
+        *   shifter (or the diode fix, or 3.3V-native Arduino) semantics if
+        *   called without parameters.
+        *   If you're not using the Shield (e.g. using the Breakout Board) or
+        *   have wired the Si4735 differently, then explicitly supply the
+        *   constructor with the actual pin numbers.
+        *   Use the hardwired pins constants above to tell the constructor you
+        *   haven't used (and hardwired) some of the pins.
+        * Parameters:
+        *   interface - interface and protocol used to talk to the chip 
+        *   pin*      - pin numbers for connections to the Si4735, with
+        *               defaults for the SparkFun Si4735 Shield already
+        *               provided.
+        */
+        Si4735(byte interface = SI4735_INTERFACE_SPI, 
+               byte pinPower = SI4735_PIN_POWER,
+               byte pinReset = SI4735_PIN_RESET,
+               byte pinGPO2 = SI4735_PIN_GPO2, byte pinSEN = SI4735_PIN_SEN);
+        
+        /*
+        * Description:
+        *   This is the destructor, it shuts the Si4735 down
+        */
+        ~Si4735() { end(true); };
+        
+        /*
+        * Description: 
+        *   Initializes the Si4735, powers up the radio in the desired mode 
+        *   and limits the bandwidth appropriately.
+        *   This function must be called before any other radio command.
+        *   The band limits are set as follows:
+        *     LW - 152 to 279 kHz
+        *     AM - 520 to 1710 kHz
+        *     SW - 2.3 to 23 MHz
+        *     FM - 87.5 to 107.9 MHz
+        * Parameters:
+        *   mode        - The desired radio mode, one of the SI4735_MODE_*
+        *                 constants.
+        *   xosc        - A 32768Hz external oscillator is present.
+        *   slowshifter - A BOB-08745 is used for level shifting between an
+        *                 Uno/Mega and the Si4735. Use a 3.3V I/O Arduino or
+        *                 shift through a BOB-10403 to be able to go up to
+        *                 1MHz by setting this to false.
+        */
+        void begin(byte mode, bool xosc = true, bool slowshifter = true);
+        
+        /*
+        * Description: 
+        *   Used to send a command and its arguments to the radio chip.
+        * Parameters:
+        *   command - the command byte, see datasheet and use one of the
+                      SI4735_CMD_* constants
+        *   arg1-7  - command arguments, see the Si4735 Programmers Guide.
+        * Returns:
+        *   The status byte the chip signalled CTS with; check 
+        *   SI4735_STATUS_ERR in it to find out whether the command failed.
+        *   If the chip hangs or browns out, the watchdog (see setWatchdog())
+        *   recovers it and sends the command again.
+        */
+        byte sendCommand(byte command, byte arg1 = 0, byte arg2 = 0,
+                         byte arg3 = 0, byte arg4 = 0, byte arg5 = 0,
+                         byte arg6 = 0, byte arg7 = 0);
+
+        /*
+        * Description: 
+        *   Same as sendCommand(), but returns right after the command has
+        *   been sent instead of waiting for CTS. Poll getStatus() for
+        *   SI4735_STATUS_CTS before talking to the chip again.
+        *   Returns the status byte if the bus got it back in the same 
+        *   transaction (see Si4735Transport), 0 otherwise.
+        */
+        byte startCommand(byte command, byte arg1 = 0, byte arg2 = 0,
+                          byte arg3 = 0, byte arg4 = 0, byte arg5 = 0,
+                          byte arg6 = 0, byte arg7 = 0);
+
+        /*
+        * Description: 
+        *   Acquires certain revision parameters from the Si4735 chip, returns
+        *   the last two digits of the chip part number (e.g. 35 for Si4735).
+        * Parameters:
+        *   FW  - Firmware Version and it is a 2 character string
+        *   CMP - Component Revision and it is a 2 character string
+        *   REV - Chip Die Revision and it is a single character
+        *   Set to NULL (or ignore) whichever parameter you don't care about.
+        * Chips are usually referred in datasheets as "Si4735-$REV$FW", for
+        * example "Si4735-C40" for the chip on the Sparkfun Shield.
+        */
+        byte getRevision(char* FW = NULL, char* CMP = NULL, char* REV = NULL,
+                         word* patch = NULL);
+
+        /*
+        * Description: 
+        *   Used to to tune the radio to a desired frequency. The library uses
+        *   the mode indicated via begin() to determine how to set the 
+        *   frequency.
+        * Parameters:
+        *   frequency - The frequency to tune to, in kHz (or in 10kHz if using
+        *               FM mode).
+        */
+        void setFrequency(word frequency);
+
+        /*
+        * Description:
+        *   Sets the options used by every subsequent tune (setFrequency() and
+        *   startTune()).
+        * Parameters:
+        *   flags  - any of SI4735_FLG_FAST (skip the tuning capacitor 
+        *            calibration, trading accuracy for speed) and, in FM only,
+        *            SI4735_FLG_FREEZE (freeze the audio metrics during the
+        *            tune); 0 restores the defaults.
+        *   antcap - antenna tuning capacitor value to use instead of having
+        *            the chip work it out on every tune; 0 means automatic
+        *            (which, in SW mode, sends the recommended value of 1
+        *            and, given a table, looks the value up in it, see 
+        *            setAntcapTable()).
+        */
+        void setTuneOptions(byte flags, word antcap = 0) {
+            _tuneFlags = flags;
+            _antcap = antcap;
+        };
+
+        /*
+        * Description:
+        *   Returns the flags given to setTuneOptions(), and the antenna 
+        *   tuning capacitor value in antcap if not NULL.
+        */
+        byte getTuneOptions(word* antcap = NULL) {
+            if(antcap) *antcap = _antcap;
+
+            return _tuneFlags;
+        };
+
+        /*
+        * Description:
+        *   Returns how long the last tune or seek took, from sending the 
+        *   command to noticing STC, in microseconds.
+        */
+        unsigned long getTuneTime(void) { return _tuneTime; };
+
+        /*
+        * Description:
+        *   Gets the frequency the chip is currently tuned to.    
+        * Parameters:
+        *   valid - will be set to true if the chip currently detects a valid
+        *           (as defined by current Seek/Tune criteria, see
+        *           FM_SEEK_TUNE_* properties in the datasheet) signal on this
+        *           frequency. Omit if you don't care.
+        */
+        word getFrequency(bool* valid = NULL);
+
+        /*
+        * Description:
+        *   Commands the radio to seek up to the next valid channel.
+        * Parameters:
+        *   wrap - set to true to allow the seek to wrap around the current
+        *          band.
+        */
+        void seekUp(bool wrap = true);
+
+        /*
+        * Description:
+        *   Commands the radio to seek down to the next valid channel.
+        * Parameters:
+        *   wrap - set to true to allow the seek to wrap around the current
+        *          band.
+        */
+        void seekDown(bool wrap = true);
+
+        /*
+        * Description:
+        *   Seeks, wrapping around the band, for the next station whose RDS
+        *   matches criteria. Each candidate is listened to for at most 
+        *   timeout ms, looking only at blocks A and B (PI, PTY, TP and, in
+        *   type 0 and 15B groups, TA), so most are decided on their first
+        *   good group. Returns the frequency of the first match; if there's
+        *   none in a full turn of the band, tunes back to where it started
+        *   and returns 0. FM only.
+        */
+        word seekRDS(const Si4735_RDS_Criteria* criteria, bool up = true,
+                     word timeout = 500);
+
+        /*
+        * Description:
+        *   Starts tuning to frequency (see setFrequency()) and returns without
+        *   waiting for the tune to complete. Poll isSeekTuneComplete() to
+        *   find out when it did.
+        */
+        void startTune(word frequency);
+
+        /*
+        * Description:
+        *   Starts seeking to the next valid channel (see seekUp() and 
+        *   seekDown()) and returns without waiting for the seek to complete.
+        *   Poll isSeekTuneComplete() to find out when it did.
+        * Parameters:
+        *   up   - seek up if true, down otherwise.
+        *   wrap - set to true to allow the seek to wrap around the current
+        *          band.
+        */
+        void startSeek(bool up, bool wrap = true);
+
+        /*
+        * Description:
+        *   Returns true if the tune or seek started with startTune() or
+        *   startSeek() has completed, false otherwise. Never blocks for
+        *   longer than one command takes.
+        */
+        bool isSeekTuneComplete(void);
+        
+        /*
+        * Description:
+        *   Adjust the threshold levels of the seek function.
+        *   FM Ranges:
+        *     SNR = [0-127] in dB, default = 3dB
+        *     RSSI = [0-127] in dBuV, default = 20dBuV
+        *   AM Ranges:
+        *     SNR = [0-63] in dB, default = 5dB
+        *     RSSI = [0-63] in dBuV, default = 19dBuV
+        */    
+        void setSeekThresholds(byte SNR, byte RSSI);
+
+        /*
+        * Description:
+        *   Works out seek thresholds (and, in FM, RDS block error settings)
+        *   that suit the antenna and location, by sampling RSQ on up to 
+        *   SI4735_CALIBRATION_SAMPLES channels spread over the band of the
+        *   current mode. The noise floor is estimated as the lower quartile
+        *   of the samples and the thresholds are set a third of the way from
+        *   it to the typical station, so weak stations still stop a seek 
+        *   while noise doesn't. Takes a few seconds, tunes back to where it
+        *   started and applies the result; returns false if no station was
+        *   found, the band plan for the mode is unusable or the chip stopped
+        *   answering (see getRSQ()), in which case nothing is applied.
+        */
+        bool calibrate(Si4735_Calibration* calibration);
+
+        /*
+        * Description:
+        *   Builds table for the band of the current mode (AM or LW; SW 
+        *   antennas are nowhere near resonant and use a fixed value): tunes
+        *   to SI4735_ANTCAP_POINTS points across it, letting the chip 
+        *   calibrate the antenna tuning capacitor, and records the value it
+        *   settled on (AM_TUNE_STATUS READANTCAP). The same points are then
+        *   tuned again from the table to time both ways. Takes a few 
+        *   seconds, tunes back to where it started and applies the table;
+        *   returns false (and applies nothing) in FM or SW, or if a tune
+        *   doesn't complete within the watchdog timeout (the chip is then
+        *   left wherever it got to, see setWatchdog()).
+        */
+        bool calibrateAntcap(Si4735_Antcap_Table* table);
+
+        /*
+        * Description:
+        *   Makes AM and LW tunes take the antenna tuning capacitor value 
+        *   from table, interpolated, instead of having the chip work it out
+        *   every time, which is most of an AM tune. Only applies in the mode
+        *   the table was built in, inside its range and when setTuneOptions()
+        *   wasn't given a value. The table is used in place, keep it around;
+        *   NULL stops using it. Returns false if table is not valid.
+        */
+        bool setAntcapTable(const Si4735_Antcap_Table* table);
+
+        /*
+        * Description:
+        *   Applies a calibration from calibrate(), returning false (and 
+        *   applying nothing) if it's corrupt or was done in a different
+        *   firmware function (FM vs. AM/SW/LW). The seek thresholds are lost
+        *   on setMode() to/from FM, apply again after it.
+        */
+        bool setCalibration(const Si4735_Calibration* calibration);
+
+        /*
+        * Description:
+        *   If in FM mode and the chip has received any RDS block, fetch it
+        *   off the chip and fill word block[4] with it, returning true;
+        *   otherwise return false without side-effects.
+        *   This function needs to be actively called (e.g. from loop()) in
+        *   order to see sensible information.
+        * Parameters:
+        *   block  - a word[4] receiving the RDS blocks A to D.
+        *   errors - receives the block error fields of this group, see the
+        *            SI4735_RDS_BLE* constants. Omit if you don't care.
+        */
+        bool readRDSBlock(word* block, byte* errors = NULL);
+
+        /*
+        * Description:
+        *   Returns true if at least one RDS group has been received while
+        *   tuned into the current station.
+        */
+        bool isRDSCapable(void) { return _haverds; };
+
+        /*
+        * Description:
+        *   Retrieves the Received Signal Quality metrics using a 
+        *   Si4735_RX_Metrics struct. Returns false (leaving RSQ alone) if 
+        *   the chip didn't answer, even after the watchdog tried to recover
+        *   it, see setWatchdog().
+        */
+        bool getRSQ(Si4735_RX_Metrics* RSQ);
+
+        /*
+        * Description:
+        *   Same as getRSQ(), in two halves that never wait: startRSQ() asks
+        *   the chip for the metrics, then isRSQReady() returns false until
+        *   they are available and true once it filled RSQ with them.
+        */
+        void startRSQ(void);
+        bool isRSQReady(Si4735_RX_Metrics* RSQ);
+
+        /*
+        * Description:
+        *   Sets the thresholds for one signal quality metric and enables the
+        *   RSQ interrupts for it, so that getRSQEvents() reports whenever the
+        *   metric goes above high or below low.
+        *   Thresholds are lost on setMode() as the chip forgets them.
+        * Parameters:
+        *   metric - one of the SI4735_RSQ_* constants. MULT and BLEND are
+        *            only available in FM mode.
+        *   low    - the low threshold, in the units getRSQ() reports the
+        *            metric in. BLEND only has this one threshold (in % stereo
+        *            blend, add 0x80 to have it count pilot presence too).
+        *   high   - the high threshold, ignored for BLEND.
+        */
+        void setRSQThresholds(byte metric, byte low, byte high = 0);
+
+        /*
+        * Description:
+        *   Selects exactly which RSQ threshold crossings raise RSQINT, as a
+        *   combination of the SI4735_STATUS_RSSI*, _SNR*, _MULT* and
+        *   _BLENDINT flags; 0 disables RSQ interrupts altogether.
+        */
+        void setRSQInterrupts(byte sources);
+
+        /*
+        * Description:
+        *   Costs a single GET_INT_STATUS (which refreshes the interrupt 
+        *   bits, so polling without the INT pin works) if no RSQ threshold
+        *   has been crossed since the last call (or the chip didn't 
+        *   answer), returning 0. Otherwise fetches (and acknowledges) the 
+        *   signal quality status and returns which thresholds were crossed,
+        *   using the same flags as setRSQInterrupts().
+        * Parameters:
+        *   RSQ - if not NULL, also filled with the current metrics, as by 
+        *         getRSQ().
+        */
+        byte getRSQEvents(Si4735_RX_Metrics* RSQ = NULL);
+
+        /*
+        * Description:
+        *   Sets the volume. Valid values are [0-63]. 
+        */
+        void setVolume(byte value) {
+            setProperty(SI4735_PROP_RX_VOLUME, 
+                        word(0x00, constrain(value, 0, 63)));
+        };
+
+        /*
+        * Description:
+        *   Gets the current volume.
+        */
+        byte getVolume(void) {
+            return lowByte(getProperty(SI4735_PROP_RX_VOLUME));
+        };
+
+        /*
+        * Description:
+        *   Increase the volume by 1. If the maximum volume has been 
+        *   reached, no further increase will take place and returns false;
+        *   otherwise true.
+        */
+        bool volumeUp(void);
+        
+        /*
+        * Description:
+        *   Decrease the volume by 1. If the minimum volume has been 
+        *   reached, no further decrease will take place and returns false;
+        *   otherwise true.
+        * Parameters:
         *   alsomute - mute the output when reaching minimum volume, in 
         *               addition to returning false
         */
-        bool volumeDown(bool alsomute = false);
+        bool volumeDown(bool alsomute = false);
+        
+        /*
+        * Description:
+        *   Mutes the audio output.
+        */
+        void mute(void) {
+            setProperty(SI4735_PROP_RX_HARD_MUTE, word(0x00, 0x03));
+        };
+
+        /*
+        * Description:
+        *   Unmutes the audio output.
+        * Parameters:
+        *   minvol - set the volume to minimum value before unmuting if true,
+        *            otherwise leave it untouched causing the chip to blast
+        *            audio out at whatever the previous volume level was.
+        */
+        void unMute(bool minvol = false);
+
+        /*
+        * Description:
+        *   Gets the current status (short read) of the radio. Learn more
+        *   about the status byte in the Si4735 Datasheet.
+        * Returns:
+        *   The status of the radio.
+        */
+        byte getStatus(void);
+
+        /*
+        * Description:
+        *   Gets the long response (long read) from the radio. Learn more
+        *   about the long response in the Si4735 Datasheet.
+        * Parameters:
+        *   response - A byte[] at least 16 bytes long for the response from
+        *              the radio to be stored in.
+        */
+        void getResponse(byte* response);
+
+        /*
+        * Description:
+        *   Powers down the radio.
+        * Parameters:
+        *   hardoff  - physically power down the chip if fed off a digital 
+        *              pin, otherwise just send SI4735_CMD_POWER_DOWN.
+        *   snapshot - if not NULL, receives the state of the receiver first,
+        *              see getSnapshot().
+        *   decoder  - if not NULL, the station identity goes in too.
+        */
+        void end(bool hardoff = false, Si4735_Snapshot* snapshot = NULL,
+                 Si4735RDSDecoder* decoder = NULL);
+
+        /*
+        * Description:
+        *   Fills snapshot with the current mode, frequency and properties
+        *   and, if decoder is not NULL, the station identity it holds.
+        */
+        void getSnapshot(Si4735_Snapshot* snapshot, 
+                         Si4735RDSDecoder* decoder = NULL);
+
+        /*
+        * Description:
+        *   Same as begin(), but brings the receiver back to snapshot (see 
+        *   end()) in one go: after POWER_UP, only the properties in snapshot
+        *   are written, then the frequency is tuned. Returns false without
+        *   touching the chip if snapshot is not valid, call begin() then.
+        * Parameters:
+        *   snapshot    - as filled by end() or getSnapshot().
+        *   decoder     - if not NULL, gets the station identity in snapshot
+        *                 right away, see Si4735RDSDecoder::setIdentity().
+        *   slowshifter - see begin().
+        */
+        bool resume(const Si4735_Snapshot* snapshot, 
+                    Si4735RDSDecoder* decoder = NULL, bool slowshifter = true);
+
+        /*
+        * Description:
+        *   Returns the time from the start of the last begin() or resume()
+        *   until the first tune after it completed (i.e. audio was playing),
+        *   in microseconds; 0 until then.
+        */
+        unsigned long getAudioTime(void) { return _audioTime; };
+
+        /*
+        * Description:
+        *   Sets deemphasis time constant (see SI4735_FLG_DEEMPH_*).
+        */
+        void setDeemphasis(byte deemph);
+
+        /*
+        * Description:
+        *   Gets the current mode of the radio (see SI4735_MODE_*).
+        */
+        byte getMode(void) { return _mode; };
+
+        /*
+        * Description:
+        *   Sets the Mode of the radio. AM, SW and LW all run on the same
+        *   firmware function, so switching among them only rewrites the band
+        *   properties that differ; the chip is only power cycled when going
+        *   from FM to any of those or back.
+        * Parameters:
+        *   mode      - the new mode of operation (see SI4735_MODE_*).
+        *   powerdown - power the chip down first, as required by datasheet.
+        *               Only used when the chip needs to be power cycled.
+        *   xosc      - an external 32768Hz oscillator is present. Likewise.
+        */
+        void setMode(byte mode, bool powerdown = true, 
+                     bool xosc = true);
+
+        /*
+        * Description:
+        *   Returns how long the last setMode() took, in microseconds.
+        */
+        unsigned long getSwitchTime(void) { return _switchTime; };
+
+        /*
+        * Description:
+        *   Replaces the band plan setMode() works from with table, an array
+        *   of four Si4735_Band_Plan in PROGMEM indexed by SI4735_MODE_*. 
+        *   Pass NULL to go back to the built-in one. Takes effect on the 
+        *   next setMode(). The built-in plan seeks in 10kHz steps on AM and
+        *   SW, 9kHz on LW and 100kHz on FM.
+        */
+        void setBandPlan(const Si4735_Band_Plan* table);
+
+        /*
+        * Description:
+        *   Retrieves the band plan entry for mode into plan.
+        */
+        void getBandPlan(byte mode, Si4735_Band_Plan* plan);
+
+        /*
+        * Description:
+        *   Sets a property value, see the SI4735_PROP_* constants and the
+        *   Si4735 Datasheet for more information.
+        */
+        void setProperty(word property, word value);
+        
+        /*
+        * Description:
+        *   Gets a property value, see the SI4735_PROP_* constants and the
+        *   Si4735 Datasheet for more information.
+        * Returns:
+        *   The current value of property.
+        */
+        word getProperty(word property);
+
+        /*
+        * Description:
+        *   Sets how long (ms) sendCommand() waits for CTS before declaring 
+        *   the chip hung, 0 to wait forever and disable the watchdog. A hung
+        *   chip, one answering with an all 1s status or one that fails even
+        *   GET_REV after SI4735_WATCHDOG_ERRORS commands in a row came back
+        *   with ERR (e.g. it browned out and lost its POWER_UP; a single ERR
+        *   is left to the caller, with the command's response intact) is 
+        *   put through the begin() reset sequence
+        *   and restored to its last mode and frequency, with the properties
+        *   (volume, mute, RDS configuration and any set with setProperty())
+        *   written since. Each recovery takes at most 
+        *   SI4735_WATCHDOG_RETRIES attempts, i.e. a few times timeout.
+        */
+        void setWatchdog(word timeout) { _watchdogTimeout = timeout; };
+
+        /*
+        * Description:
+        *   Runs a recovery as described above, right away. Returns true if
+        *   the chip is back.
+        */
+        bool recover(void);
+
+        /*
+        * Description:
+        *   Returns the watchdog counters.
+        */
+        const Si4735_Watchdog_Stats* getWatchdogStats(void) {
+            return &_watchdogStats;
+        };
+
+        /*
+        * Description:
+        *   Shares the bus the chip is on with other devices: every 
+        *   transaction with the chip will take and release the bus through
+        *   arbiter, and the bus is free for others in between, including
+        *   while we wait for CTS or STC. Call before begin(), pass NULL to
+        *   stop sharing.
+        */
+        void setArbiter(Si4735BusArbiter* arbiter) { _arbiter = arbiter; };
+
+#if defined(SI4735_LINUX)
+        /*
+        * Description:
+        *   Talks to the chip through transport (e.g. a Si4735I2CDev or 
+        *   Si4735SPIDev) instead of the Arduino SPI/Wire libraries, which
+        *   don't exist on the host. Call before begin().
+        */
+        void setTransport(Si4735Transport* transport) {
+            _transport = transport;
+        };
+#endif
+
+        /*
+        * Description:
+        *   Sets a firmware patch to be loaded into the chip right after each
+        *   POWER_UP into function (i.e. from begin() and setMode()). The
+        *   image is streamed to the chip 8 bytes at a time, straight from 
+        *   flash, and is never copied to RAM. Call before begin(); pass a
+        *   size of 0 to stop patching. Returns false (and stops patching)
+        *   if size is not a multiple of 8.
+        *   On Linux, mmap() a patch file and pass the mapping as image.
+        * Parameters:
+        *   image    - patch image in PROGMEM, as supplied by Silicon Labs: a
+        *              sequence of 8-byte PATCH_ARGS/PATCH_DATA commands.
+        *   size     - size of image in bytes, a multiple of 8.
+        *   patchID  - the patch ID getRevision() reports once the patch is
+        *              running, used to verify the upload; 0 to skip that.
+        *   function - the function the patch is for, SI4735_FUNC_FM or
+        *              SI4735_FUNC_AM.
+        */
+        bool setPatch(const byte* image, word size, word patchID = 0,
+                      byte function = SI4735_FUNC_AM);
+
+#if !defined(SI4735_LINUX)
+        /*
+        * Description:
+        *   Same as above, but reads the patch image off a Stream (e.g. an SD
+        *   File) instead of flash. A Stream can't be rewound from here, so
+        *   the image is only applied once, on the next POWER_UP into 
+        *   function: call setPatch() again (with the stream rewound, e.g. 
+        *   File::seek(0)) before each setMode() that should be patched. A 
+        *   recovery (see setWatchdog()) powers the chip up unpatched.
+        */
+        bool setPatch(Stream* image, word size, word patchID = 0,
+                      byte function = SI4735_FUNC_AM);
+#endif
+
+        /*
+        * Description:
+        *   Returns true if the patch set with setPatch() was loaded (and, if
+        *   a patch ID was given, verified) on the last POWER_UP.
+        */
+        bool isPatched(void) { return _patched; };
+
+        /*
+        * Description:
+        *   Returns the time the last patch upload took, in microseconds.
+        */
+        unsigned long getPatchTime(void) { return _patchTime; };
+
+    private:
+        //Sends commands on its own, but must keep the watchdog informed
+        friend class Si4735CommandQueue;
+
+        byte _pinPower, _pinReset, _pinGPO2, _pinSDIO, _pinGPO1, _pinSCLK,
+             _pinSEN;
+        byte _mode, _response[16], _i2caddr;
+        bool _haverds, _slowshifter, _patched, _poweredup, _bandSW, _xosc;
+        Si4735BusArbiter* _arbiter;
+#if defined(SI4735_LINUX)
+        Si4735Transport* _transport;
+#endif
+        const byte* _patchImage;
+#if !defined(SI4735_LINUX)
+        Stream* _patchStream;
+#endif
+        word _patchSize, _patchID;
+        byte _patchFunction, _rsqsources, _tuneFlags;
+        bool _rdsconfigured;
+        byte _rdsConfig;
+        word _rdsConfidence;
+        word _antcap;
+        const Si4735_Antcap_Table* _antcapTable;
+        const Si4735_Band_Plan* _bandPlan;
+        unsigned long _patchTime, _tuneStart, _tuneTime, _switchTime;
+        word _frequency, _watchdogTimeout;
+        bool _recovering, _recoveryFailed, _booting;
+        byte _errorStreak;
+        unsigned long _bootStart, _audioTime;
+        byte _cachedProperties;
+        word _cacheProperty[SI4735_WATCHDOG_PROPERTIES];
+        word _cacheValue[SI4735_WATCHDOG_PROPERTIES];
+        Si4735_Watchdog_Stats _watchdogStats;
         
         /*
         * Description:
-        *   Mutes the audio output.
+        *   Returns the antenna tuning capacitor value the table set with 
+        *   setAntcapTable() gives for frequency, 0 (automatic) if none.
         */
-        void mute(void) {
-            setProperty(SI4735_PROP_RX_HARD_MUTE, word(0x00, 0x03));
-        };
+        word lookupAntcap(word frequency);
 
         /*
         * Description:
-        *   Unmutes the audio output.
+        *   Remembers property as set to value for recover() and 
+        *   getSnapshot(), without sending anything.
+        */
+        void cacheProperty(word property, word value);
+
+        /*
+        * Description:
+        *   Polls for the tune startTune() began to complete, for no longer 
+        *   than the watchdog timeout (forever if that is 0); returns false
+        *   if it ran out.
+        */
+        bool waitForTune(void);
+
+        /*
+        * Description:
+        *   Runs the reset sequence and sets the bus up, the first half of 
+        *   begin().
+        */
+        void reset(void);
+
+        /*
+        * Description:
+        *   Sends POWER_UP for function, uploads the patch if there is one
+        *   for it and sets the GPO lines up.
+        */
+        void powerUp(byte function, bool xosc);
+
+        /*
+        * Description:
+        *   Polls the chip until it signals CTS, for at most the watchdog 
+        *   timeout; status is what the command was sent with.
+        */
+        byte waitForCTS(byte status);
+
+        /*
+        * Description:
+        *   Returns true if the status command got back means the chip needs
+        *   recovering, and counts why.
+        */
+        bool isFaulty(byte command, byte status);
+
+        /*
+        * Description:
+        *   Enables RDS reception, unless already enabled since the last
+        *   POWER_UP.
+        */
+        void enableRDS(void);
+
+        /*
+        * Description:
+        *   Does the housekeeping needed once a tune or seek completed.
+        */
+        void completeSeekTune(void);
+
+        /*
+        * Description:
+        *   Listens to the RDS of the current station for at most timeout ms
+        *   and returns true as soon as it's known to match criteria, false
+        *   as soon as it's known not to or when time runs out.
+        */
+        bool listenRDS(const Si4735_RDS_Criteria* criteria, word timeout);
+
+        /*
+        * Description:
+        *   Writes the band properties of the current mode that differ from
+        *   previous, the band plan the chip is currently holding.
+        */
+        void applyBandPlan(const Si4735_Band_Plan* previous);
+
+        /*
+        * Description:
+        *   Writes the interrupt sources we need to GPO_IEN.
+        */
+        void enableInterrupts(void);
+
+        /*
+        * Description:
+        *   Fills RSQ with the metrics in the last RSQ_STATUS response.
+        */
+        void decodeRSQ(Si4735_RX_Metrics* RSQ);
+        
+        /*
+        * Description:
+        *   Waits for completion of various operations.
         * Parameters:
-        *   minvol - set the volume to minimum value before unmuting if true,
-        *            otherwise leave it untouched causing the chip to blast
-        *            audio out at whatever the previous volume level was.
+        *   which - interrupt flag to wait for, see SI4735_STATUS_*
         */
-        void unMute(bool minvol = false);
+        void waitForInterrupt(byte which);        
 
         /*
         * Description:
-        *   Gets the current status (short read) of the radio. Learn more
-        *   about the status byte in the Si4735 Datasheet.
-        * Returns:
-        *   The status of the radio.
+        *   Streams the patch set with setPatch() into the chip, returning
+        *   true if it was accepted (and verified, if a patch ID was given).
         */
-        byte getStatus(void);
+        bool uploadPatch(void);
 
         /*
         * Description:
-        *   Gets the long response (long read) from the radio. Learn more
-        *   about the long response in the Si4735 Datasheet.
+        *   Take the bus and select the chip, then deselect it and release the
+        *   bus, around each transaction with the chip.
+        */
+        void beginTransaction(void);
+        void endTransaction(void);
+};
+
+class Si4735Manager
+{
+    public:
+        /*
+        * Description:
+        *   Default constructor.
+        */
+        Si4735Manager();
+
+        /*
+        * Description:
+        *   Puts tuner under management and returns its index, to be used with
+        *   the other methods, or 0xFF if SI4735_MANAGER_TUNERS tuners are
+        *   already managed. The tuner must have been begin()-ed already.
         * Parameters:
-        *   response - A byte[] at least 16 bytes long for the response from
-        *              the radio to be stored in.
+        *   tuner   - the tuner to manage.
+        *   decoder - if not NULL, RDS groups drained off tuner are fed to it.
         */
-        void getResponse(byte* response);
+        byte addTuner(Si4735* tuner, Si4735RDSDecoder* decoder = NULL);
 
         /*
         * Description:
-        *   Powers down the radio.
+        *   Queues a job on tuner, returning false if its queue is full.
         * Parameters:
-        *   hardoff - physically power down the chip if fed off a digital pin,
-        *             otherwise just send SI4735_CMD_POWER_DOWN.
+        *   tuner - index returned by addTuner().
+        *   type  - one of the SI4735_JOB_* constants:
+        *           TUNE      - tune to from.
+        *           SEEK_UP   - seek up from the current frequency, wrapping.
+        *           SEEK_DOWN - seek down from the current frequency, wrapping.
+        *           SCAN      - report every valid station between from and
+        *                       to, inclusive.
+        *   from  - frequency for TUNE and lower scan limit for SCAN.
+        *   to    - upper scan limit for SCAN.
         */
-        void end(bool hardoff = false);
+        bool enqueue(byte tuner, byte type, word from = 0, word to = 0);
 
         /*
         * Description:
-        *   Sets deemphasis time constant (see SI4735_FLG_DEEMPH_*).
+        *   Returns the number of jobs queued on tuner, including the one
+        *   currently running.
         */
-        void setDeemphasis(byte deemph);
+        byte getQueueLength(byte tuner);
 
         /*
         * Description:
-        *   Gets the current mode of the radio (see SI4735_MODE_*).
+        *   Returns true when no tuner has any job left.
         */
-        byte getMode(void) { return _mode; };
+        bool isIdle(void);
+
+        /*
+        * Description:
+        *   Gives each tuner one turn: a tuner waiting for STC is polled (no
+        *   more often than every pollInterval ms), an idle one has its RDS
+        *   FIFO drained and starts its next job. Never waits for a seek or
+        *   tune to complete, call repeatedly (e.g. from loop()).
+        */
+        void pump(void);
+
+        /*
+        * Description:
+        *   Sets how often, in ms, a tuner waiting for STC is polled.
+        */
+        void setPollInterval(byte pollInterval) {
+            _pollInterval = pollInterval;
+        };
+
+        /*
+        * Description:
+        *   Sets the function called for every valid station found by a seek
+        *   or scan job, with the tuner index and the station frequency.
+        */
+        void setStationCallback(void (*callback)(byte tuner, word frequency)) {
+            _onStation = callback;
+        };
+
+        /*
+        * Description:
+        *   Fills stats with the work counters of tuner.
+        */
+        void getStats(byte tuner, Si4735_Manager_Stats* stats);
+
+        /*
+        * Description:
+        *   Fills stats with the work counters summed over all tuners and
+        *   returns the time in ms since the manager was constructed, so that
+        *   throughput can be worked out.
+        */
+        unsigned long getTotals(Si4735_Manager_Stats* stats);
+
+    private:
+        typedef struct {
+            byte type;
+            word from, to;
+        } Job;
+
+        typedef struct {
+            Si4735* tuner;
+            Si4735RDSDecoder* decoder;
+            Job queue[SI4735_MANAGER_QUEUE];
+            byte head, count;
+            bool running, scanning;
+            word last;
+            unsigned long started, polled;
+            Si4735_Manager_Stats stats;
+        } Slot;
+
+        Slot _slots[SI4735_MANAGER_TUNERS];
+        byte _tuners, _pollInterval;
+        unsigned long _created;
+        void (*_onStation)(byte tuner, word frequency);
+
+        /*
+        * Description:
+        *   Starts the job at the head of the queue of slot.
+        */
+        void startJob(Slot* slot);
+
+        /*
+        * Description:
+        *   Handles STC for the running job of slot, returning true if the
+        *   job is finished.
+        */
+        bool completeJob(byte tuner, Slot* slot);
+};
+
+class Si4735CommandQueue
+{
+    public:
+        /*
+        * Description:
+        *   Constructor, tuner is the (begin()-ed) chip the commands go to.
+        */
+        Si4735CommandQueue(Si4735* tuner);
 
         /*
         * Description:
-        *   Sets the Mode of the radio.
+        *   Queues a command, returning false if the queue is full. Nothing
+        *   is sent until pump() is called.
         * Parameters:
-        *   mode      - the new mode of operation (see SI4735_MODE_*).
-        *   powerdown - power the chip down first, as required by datasheet.
-        *   xosc      - an external 32768Hz oscillator is present.
+        *   command, arg1-7 - as for Si4735::sendCommand().
+        *   response        - if not NULL, the 16-byte response to the 
+        *                     command is read into it once CTS is back up; it
+        *                     must stay valid until then.
+        *   callback        - if not NULL, called once the command completed
+        *                     with the status byte and response.
         */
-        void setMode(byte mode, bool powerdown = true, 
-                     bool xosc = true);
+        bool enqueue(byte command, byte arg1 = 0, byte arg2 = 0, 
+                     byte arg3 = 0, byte arg4 = 0, byte arg5 = 0,
+                     byte arg6 = 0, byte arg7 = 0, byte* response = NULL,
+                     void (*callback)(byte status, byte* response) = NULL);
 
         /*
         * Description:
-        *   Sets a property value, see the SI4735_PROP_* constants and the
-        *   Si4735 Datasheet for more information.
+        *   Queues a property write, returning false if the queue is full.
+        *   If a write to the same property is still queued, with only other
+        *   property writes after it, its value is replaced instead; e.g. a
+        *   volume fade queued faster than the bus can take it only sends 
+        *   the last volume. Once sent, the value is remembered as 
+        *   Si4735::setProperty() would, for recovery and snapshots.
         */
-        void setProperty(word property, word value);
-        
+        bool enqueueProperty(word property, word value,
+                             void (*callback)(byte status, 
+                                              byte* response) = NULL);
+
         /*
         * Description:
-        *   Gets a property value, see the SI4735_PROP_* constants and the
-        *   Si4735 Datasheet for more information.
-        * Returns:
-        *   The current value of property.
+        *   Advances the queue by one step without ever waiting: if a command
+        *   is in flight and CTS is back up, completes it, then sends the 
+        *   next one. Call repeatedly (e.g. from loop()); returns true while
+        *   there is work left. A command that sees no CTS within the 
+        *   watchdog timeout is handled as Si4735::sendCommand() would: the
+        *   chip is recovered and the command sent once more, or else it 
+        *   completes with ERR set in its status.
+        *   The tuner must not be used directly while the queue is busy.
         */
-        word getProperty(word property);
+        bool pump(void);
+
+        /*
+        * Description:
+        *   Pumps until the queue is empty.
+        */
+        void flush(void) { while(pump()) yield(); };
+
+        /*
+        * Description:
+        *   Returns the number of commands queued, including the one in 
+        *   flight.
+        */
+        byte getLength(void) { return _count; };
+
+        /*
+        * Description:
+        *   Returns the number of commands sent and property writes merged 
+        *   away, respectively, since construction.
+        */
+        unsigned long getSent(void) { return _sent; };
+        unsigned long getMerged(void) { return _merged; };
 
     private:
-        byte _pinPower, _pinReset, _pinGPO2, _pinSDIO, _pinGPO1, _pinSCLK,
-             _pinSEN;
-        byte _mode, _response[16], _i2caddr;
-        bool _haverds;
-        
+        typedef struct {
+            byte command, args[7];
+            byte* response;
+            void (*callback)(byte status, byte* response);
+        } Entry;
+
+        Si4735* _tuner;
+        Entry _queue[SI4735_COMMAND_QUEUE];
+        byte _head, _count;
+        bool _inflight, _retried;
+        unsigned long _sent, _merged, _started;
+};
+
+class Si4735RDSMonitor
+{
+    public:
         /*
         * Description:
-        *   Enables RDS reception.
+        *   Constructor.
+        * Parameters:
+        *   tuner   - the (begin()-ed) chip to monitor with.
+        *   decoder - if not NULL, every RDS group received while awake is
+        *             fed to it, e.g. to read the CT that was just signalled.
         */
-        void enableRDS(void);
-        
+        Si4735RDSMonitor(Si4735* tuner, Si4735RDSDecoder* decoder = NULL);
+
         /*
         * Description:
-        *   Waits for completion of various operations.
+        *   Starts monitoring: powers the chip down and, from then on, has 
+        *   pump() wake it up every period ms, listen for at most window ms
+        *   and power it down again. The listen ends early once every 
+        *   watched field is known. The duty cycle is roughly 
+        *   (power-up + tune + listen) / period. Wakes use FAST tunes, see
+        *   Si4735::setTuneOptions(); the tuner's own options are put back 
+        *   after each.
         * Parameters:
-        *   which - interrupt flag to wait for, see SI4735_STATUS_*
+        *   frequency - FM station to monitor.
+        *   events    - what to watch for, any of SI4735_MONITOR_*:
+        *               TA    - a traffic announcement is on.
+        *               ALARM - PTY is 31 (alarm).
+        *               CT    - a CT (clock time) group was received, 
+        *                       which only comes once a minute.
+        *   period    - time between wakes, in ms.
+        *   window    - longest time to listen for RDS, in ms.
+        *   xosc      - as for Si4735::setMode().
         */
-        void waitForInterrupt(byte which);        
+        void begin(word frequency, byte events, unsigned long period,
+                   word window, bool xosc = true);
+
+        /*
+        * Description:
+        *   Stops monitoring, leaving the chip awake and tuned to the 
+        *   monitored station.
+        */
+        void end(void);
+
+        /*
+        * Description:
+        *   Call repeatedly (e.g. from loop()). Returns at once if it's not
+        *   time to wake yet, otherwise blocks for one wake cycle and 
+        *   returns the SI4735_MONITOR_* events seen during it.
+        */
+        byte pump(void);
+
+        /*
+        * Description:
+        *   Returns the time left until the next wake, in ms, so the host
+        *   can sleep in the meantime.
+        */
+        unsigned long getSleepTime(void);
+
+        /*
+        * Description:
+        *   Returns the time from the start of the last wake to its first 
+        *   good RDS group, in ms, or 0 if none came in.
+        */
+        unsigned long getWakeLatency(void) { return _latency; };
+
+        /*
+        * Description:
+        *   Returns the share of the time the chip was awake since begin(),
+        *   in tenths of a percent.
+        */
+        word getDutyCycle(void);
+
+    private:
+        Si4735* _tuner;
+        Si4735RDSDecoder* _decoder;
+        word _frequency, _window;
+        byte _events;
+        bool _xosc, _running;
+        unsigned long _period, _started, _woken, _awake, _latency;
+
+        /*
+        * Description:
+        *   Listens to the RDS of the current station, returning the events
+        *   seen.
+        */
+        byte listen(unsigned long woken);
+};
+
+#if !defined(SI4735_LINUX)
+//The device end of the Si4735Link protocol (see SI4735_LINK_*): lets a host
+//(e.g. Si4735LinkClient in Si4735-linux.h) drive tuner over a serial port,
+//in batches, and have RDS groups and RSQ samples streamed back to it.
+class Si4735Link
+{
+    public:
+        /*
+        * Description:
+        *   Constructor, tuner is the (begin()-ed) chip to drive.
+        */
+        Si4735Link(Si4735* tuner);
+
+        /*
+        * Description:
+        *   Starts talking over stream (e.g. Serial, already begin()-ed).
+        */
+        void begin(Stream* stream);
+
+        /*
+        * Description:
+        *   Call repeatedly (e.g. from loop()): handles whatever frames came
+        *   in, then sends the RDS groups and RSQ samples that are due.
+        */
+        void pump(void);
+
+        /*
+        * Description:
+        *   Returns the number of frames handled and of frames dropped for a
+        *   bad CRC or length, respectively.
+        */
+        unsigned long getFrames(void) { return _frames; };
+        unsigned long getErrors(void) { return _errors; };
+
+    private:
+        Si4735* _tuner;
+        Stream* _stream;
+        //LEN, SEQ, TYPE, payload, CRC
+        byte _frame[3 + SI4735_LINK_PAYLOAD + 2];
+        byte _received, _streams, _events;
+        bool _synced;
+        word _rsqInterval;
+        unsigned long _rsqSent, _rdsPolled, _frames, _errors;
+        //SEQ and CRC of the last request and the reply sent to it, so that
+        //a request sent again (the reply got lost) is answered, not rerun
+        byte _requestSeq, _replyType, _replyLength;
+        byte _reply[SI4735_LINK_PAYLOAD];
+        word _requestCRC;
+        bool _haveReply;
+
+        /*
+        * Description:
+        *   Runs the frame in _frame and replies to it.
+        */
+        void handleFrame(void);
+
+        /*
+        * Description:
+        *   Replies to the request in _frame, remembering the reply.
+        */
+        void reply(byte type, const byte* payload, byte length);
+
+        /*
+        * Description:
+        *   Sends a frame.
+        */
+        void send(byte seq, byte type, const byte* payload, byte length);
 };
+#endif
 
 #endif
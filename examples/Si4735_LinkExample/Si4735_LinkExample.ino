@@ -0,0 +1,58 @@
+/*
+* Si4735 Link Example Sketch
+* Written by Radu - Eosif Mihailescu
+*
+* This example sketch turns the Arduino into a remote-controlled tuner: a
+* program on the computer it's plugged in sends it commands and property
+* accesses through the Si4735Link binary protocol and gets RDS groups and
+* signal quality readings back as they come.
+*
+* HARDWARE SETUP:
+* This sketch assumes you are using the Si4735 Shield from SparkFun
+* Electronics.
+* The shield should be plugged into an Arduino Main Board (Uno, Mega etc.)
+*
+* USING THE SKETCH:
+* Upload the sketch, then drive the tuner from the computer with 
+* Si4735LinkClient (see Si4735-linux.h), e.g.:
+*   Si4735LinkClient link;
+*   word props[] = {SI4735_PROP_FM_SEEK_BAND_BOTTOM,
+*                   SI4735_PROP_FM_SEEK_BAND_TOP}, values[] = {8750, 10790};
+*   link.open("/dev/ttyACM0", 115200);
+*   link.setProperties(props, values, 2);
+*   link.setStreams(SI4735_LINK_STREAM_RDS | SI4735_LINK_STREAM_RSQ, 500);
+*   while(link.poll(1000));
+* Every frame is CRC-checked and answered, so the host can batch several
+* commands in one round trip and retry whatever got lost on the way.
+*
+* NOTES:
+* Nothing else may write to Serial: stray bytes are dropped by the host, but
+* cost it a resynchronization. Use Si4735_SerialExample to type commands by
+* hand instead.
+*/
+
+//Due to a bug in Arduino, these need to be included here too/first
+#include <SPI.h>
+#include <Wire.h>
+
+//Add the Si4735 Library to the sketch
+#include <Si4735.h>
+
+//Create an instance of the Si4735 named radio and the link driving it
+Si4735 radio;
+Si4735Link link(&radio);
+
+void setup()
+{
+  //Binary frames don't mind speed, the more the merrier
+  Serial.begin(115200);
+
+  //Initialize the radio and hand it over to the host
+  radio.begin(SI4735_MODE_FM);
+  link.begin(&Serial);
+}
+
+void loop()
+{
+  link.pump();
+}
@@ -0,0 +1,134 @@
+/*
+* Si4735 Batch Decoder Check
+* Written by Radu - Eosif Mihailescu
+*
+* This host program checks that Si4735BatchDecoder makes the same of an RDS
+* archive as streaming every group through Si4735RDSDecoder does: it makes
+* up 16 stations' worth of random groups (about 3.3M in all, some with
+* uncorrectable blocks), runs them through both and compares what comes
+* out, then prints the throughput of each.
+*
+* BUILDING AND RUNNING:
+*   g++ -O2 -DSI4735_LINUX -I../.. Si4735_BatchCheck.cpp ../../Si4735.cpp \
+*       ../../Si4735-linux.cpp -pthread -lrt -o Si4735_BatchCheck
+*   ./Si4735_BatchCheck [threads]
+* It exits non-zero if any station decoded differently.
+*/
+
+#include "Si4735-linux.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK_STATIONS 16
+#define CHECK_GROUPS 400000UL
+
+//Group types, by their code in block B (type * 2 + version): 0A and 2A
+//most, then 1A, 3A, 4A, 8A, 10A, 12A, 14A and 15B
+static const byte groupTypes[] = {0, 0, 0, 0, 4, 4, 4, 2, 6, 8, 20, 31, 24,
+                                  16, 28};
+
+static bool sameRDS(Si4735RDSDecoder* a, Si4735RDSDecoder* b){
+    Si4735_RDS_Data x, y;
+    Si4735_RDS_Time tx, ty;
+    bool hx, hy;
+
+    a->getRDSData(&x);
+    b->getRDSData(&y);
+    hx = a->getRDSTime(&tx);
+    hy = b->getRDSTime(&ty);
+    if(x.programIdentifier != y.programIdentifier || x.TP != y.TP ||
+       x.TA != y.TA || x.MS != y.MS || x.PTY != y.PTY || x.DICC != y.DICC ||
+       x.ECC != y.ECC || x.LIC != y.LIC || x.PIN != y.PIN ||
+       strcmp(x.programService, y.programService) ||
+       strcmp(x.programTypeName, y.programTypeName) ||
+       strcmp(x.radioText, y.radioText) ||
+       a->getRTHash() != b->getRTHash() || hx != hy) return false;
+
+    return !hx || (tx.tm_min == ty.tm_min && tx.tm_hour == ty.tm_hour &&
+                   tx.tm_mday == ty.tm_mday && tx.tm_mon == ty.tm_mon &&
+                   tx.tm_year == ty.tm_year && tx.tm_offset == ty.tm_offset);
+}
+
+int main(int argc, char** argv){
+    static uint16_t* blocks[CHECK_STATIONS][4];
+    static uint8_t* errors[CHECK_STATIONS];
+    static Si4735_RDS_Batch batch[CHECK_STATIONS];
+    Si4735BatchDecoder decoder;
+    Si4735RDSDecoder* reference;
+    Si4735_Batch_Thread_Stats stats;
+    unsigned long count, start, total;
+    byte threads, type;
+    word group[4];
+    int mismatches;
+
+    threads = (argc > 1) ? atoi(argv[1]) : 4;
+    srand(1);
+    total = 0;
+    for(byte s = 0; s < CHECK_STATIONS; s++) {
+        //Stations of different lengths, so that the scheduling shows
+        count = CHECK_GROUPS / (s % 4 + 1);
+        for(byte b = 0; b < 4; b++)
+            blocks[s][b] = (uint16_t *)malloc(count * sizeof(uint16_t));
+        errors[s] = (uint8_t *)malloc(count);
+        for(unsigned long i = 0; i < count; i++) {
+            type = groupTypes[rand() % sizeof(groupTypes)];
+            //Now and then a PI from a neighbour on the same channel
+            blocks[s][0][i] = 0x1000 + s * 16 + (rand() % 50 == 0);
+            blocks[s][1][i] = (type << 11) | (rand() & 0x07FF);
+            blocks[s][2][i] = 0x2000 | (rand() & 0x5F5F);
+            blocks[s][3][i] = 0x4141 + (rand() % 26) * 0x0101;
+            //1 in 20 with block A uncorrectable, about 1 in 4 corrected
+            errors[s][i] = (rand() % 20 == 0) ? 0xC0 :
+                           ((rand() % 4 == 0) ? 0x15 : 0x00);
+        }
+        batch[s].count = count;
+        for(byte b = 0; b < 4; b++) batch[s].block[b] = blocks[s][b];
+        batch[s].errors = errors[s];
+        decoder.addStation(&batch[s]);
+        total += count;
+    }
+
+    decoder.run(threads);
+    for(byte t = 0; decoder.getThreadStats(t, &stats); t++)
+        printf("thread %u: %lu stations, %llu groups, %llu decoded, "
+               "%lluus busy\n", t, stats.stations, stats.groups,
+               stats.decoded, stats.busy);
+    printf("batch: %lu groups, %lu groups/s per core\n", total,
+           decoder.getRate());
+
+    mismatches = 0;
+    start = micros();
+    for(byte s = 0; s < CHECK_STATIONS; s++) {
+        reference = new Si4735RDSDecoder();
+        for(unsigned long i = 0; i < batch[s].count; i++) {
+            //As run() does by default, drop groups with uncorrectable blocks
+            if(((errors[s][i] & SI4735_RDS_BLEA_MASK) >>
+                SI4735_RDS_BLEA_SHR) == SI4735_RDS_BLE_U ||
+               ((errors[s][i] & SI4735_RDS_BLEB_MASK) >>
+                SI4735_RDS_BLEB_SHR) == SI4735_RDS_BLE_U ||
+               ((errors[s][i] & SI4735_RDS_BLEC_MASK) >>
+                SI4735_RDS_BLEC_SHR) == SI4735_RDS_BLE_U ||
+               ((errors[s][i] & SI4735_RDS_BLED_MASK) >>
+                SI4735_RDS_BLED_SHR) == SI4735_RDS_BLE_U)
+                continue;
+            for(byte b = 0; b < 4; b++) group[b] = blocks[s][b][i];
+            reference->decodeRDSBlock(group);
+        }
+        if(!sameRDS(reference, decoder.getDecoder(s))) {
+            printf("station %u decoded differently\n", s);
+            mismatches++;
+        };
+        delete reference;
+    }
+    printf("streaming: %llu groups/s\n",
+           total * 1000000ULL / (micros() - start));
+    printf("%d of %d stations decoded differently\n", mismatches,
+           CHECK_STATIONS);
+
+    for(byte s = 0; s < CHECK_STATIONS; s++) {
+        for(byte b = 0; b < 4; b++) free(blocks[s][b]);
+        free(errors[s]);
+    }
+
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,188 @@
+/*
+* Si4735 Fake Device Check
+* Written by Radu - Eosif Mihailescu
+*
+* This host program drives the Linux transports (Si4735I2CDev, Si4735SPIDev
+* and Si4735GPIO) against an in-process fake device: every system call they
+* make goes through a Si4735_Syscall_Ops that answers like /dev/i2c-N,
+* /dev/spidevB.C and /dev/gpiochipN would, with a tiny Si4735 model behind
+* the bus. No hardware or kernel driver is needed.
+*
+* BUILDING AND RUNNING:
+*   g++ -DSI4735_LINUX -I../.. Si4735_FakeDevice.cpp ../../Si4735.cpp \
+*       ../../Si4735-linux.cpp -pthread -lrt -o Si4735_FakeDevice
+*   ./Si4735_FakeDevice
+* It prints the counters of each transport and exits non-zero if the chip
+* model didn't see what the library meant to tell it.
+*/
+
+#include "Si4735-linux.h"
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <linux/spi/spidev.h>
+#include <linux/gpio.h>
+#include <stdio.h>
+
+//SPI control byte for an 8-byte command write, see AN332
+#define FAKE_CP_WRITE8 0x48
+//I2C address with SEN tied low (SI4735_PIN_SEN_HWL)
+#define FAKE_I2C_ADDRESS 0x11
+
+//File descriptors the fake hands out
+#define FAKE_FD_I2C 3
+#define FAKE_FD_SPI 4
+#define FAKE_FD_CHIP 10
+#define FAKE_FD_LINES 20
+
+//A Si4735 that is always clear to send and has always completed its last
+//tune (CTS | STCINT), remembers properties and answers GET_PROPERTY and
+//GET_REV; everything else gets an all-zeros response.
+static struct {
+    word property[16], value[16];
+    byte properties;
+    byte response[16];
+    unsigned long commands;
+} chip;
+static unsigned long gpioCalls;
+
+static void chipCommand(const byte* command){
+    word property;
+
+    chip.commands++;
+    memset(chip.response, 0x00, sizeof(chip.response));
+    chip.response[0] = SI4735_STATUS_CTS | SI4735_STATUS_STCINT;
+    property = word(command[2], command[3]);
+    switch(command[0]) {
+        case SI4735_CMD_GET_REV:
+            chip.response[1] = 35;
+            break;
+        case SI4735_CMD_SET_PROPERTY:
+            for(byte i = 0; i < chip.properties; i++)
+                if(chip.property[i] == property) {
+                    chip.value[i] = word(command[4], command[5]);
+                    return;
+                };
+            if(chip.properties < 16) {
+                chip.property[chip.properties] = property;
+                chip.value[chip.properties++] = word(command[4], command[5]);
+            };
+            break;
+        case SI4735_CMD_GET_PROPERTY:
+            for(byte i = 0; i < chip.properties; i++)
+                if(chip.property[i] == property) {
+                    chip.response[2] = highByte(chip.value[i]);
+                    chip.response[3] = lowByte(chip.value[i]);
+                };
+            break;
+    }
+}
+
+static int fakeOpen(const char* path, int flags){
+    (void)flags;
+    if(strstr(path, "gpiochip")) return FAKE_FD_CHIP;
+
+    return strstr(path, "spidev") ? FAKE_FD_SPI : FAKE_FD_I2C;
+}
+
+static int fakeClose(int fd){
+    (void)fd;
+
+    return 0;
+}
+
+static int fakeI2C(struct i2c_rdwr_ioctl_data* transfer){
+    for(unsigned i = 0; i < transfer->nmsgs; i++)
+        if(transfer->msgs[i].flags & I2C_M_RD)
+            memcpy(transfer->msgs[i].buf, chip.response,
+                   transfer->msgs[i].len);
+        else chipCommand(transfer->msgs[i].buf);
+
+    return 0;
+}
+
+static int fakeSPI(struct spi_ioc_transfer* transfers, byte count){
+    const byte* tx;
+    byte* rx;
+
+    for(byte i = 0; i < count; i++) {
+        tx = (const byte *)(unsigned long)transfers[i].tx_buf;
+        rx = (byte *)(unsigned long)transfers[i].rx_buf;
+        //The control byte says which way the rest goes, the chip answers
+        //one byte after it
+        if(tx[0] == FAKE_CP_WRITE8) chipCommand(&tx[1]);
+        else if(rx) memcpy(&rx[1], chip.response, transfers[i].len - 1);
+    }
+
+    return 0;
+}
+
+static int fakeIoctl(int fd, unsigned long request, void* arg){
+    switch(fd) {
+        case FAKE_FD_I2C:
+            if(request != I2C_RDWR) return -1;
+            return fakeI2C((struct i2c_rdwr_ioctl_data *)arg);
+        case FAKE_FD_SPI:
+            if(request == SPI_IOC_MESSAGE(1))
+                return fakeSPI((struct spi_ioc_transfer *)arg, 1);
+            if(request == SPI_IOC_MESSAGE(2))
+                return fakeSPI((struct spi_ioc_transfer *)arg, 2);
+            //Mode, word size and speed
+            return 0;
+        default:
+            gpioCalls++;
+            if(request == GPIO_V2_GET_LINE_IOCTL)
+                ((struct gpio_v2_line_request *)arg)->fd = FAKE_FD_LINES;
+            return 0;
+    }
+}
+
+static ssize_t fakeRead(int fd, void* buffer, size_t size){
+    (void)fd;
+    (void)buffer;
+    (void)size;
+
+    return 0;
+}
+
+static const Si4735_Syscall_Ops fake = {fakeOpen, fakeClose, fakeIoctl,
+                                        fakeRead};
+
+//Brings a chip up over transport and checks a property round trip
+static bool check(const char* name, Si4735LinuxTransport* transport,
+                  byte interface){
+    Si4735 radio(interface, SI4735_PIN_POWER_HW, 9, 2, SI4735_PIN_SEN_HWL);
+    Si4735_Transport_Stats stats;
+    bool good;
+
+    memset((void *)&chip, 0x00, sizeof(chip));
+    radio.setTransport(transport);
+    radio.begin(SI4735_MODE_FM);
+    radio.setVolume(42);
+    good = (radio.getVolume() == 42);
+    transport->getStats(&stats);
+    printf("%s: %s, %lu commands, %lu writes, %lu reads, %lu syscalls, "
+           "%lu errors\n", name, good ? "OK" : "FAILED", chip.commands,
+           stats.writes, stats.reads, stats.syscalls, stats.errors);
+
+    return good && !stats.errors && stats.writes == chip.commands;
+}
+
+int main(void){
+    Si4735GPIO gpio(&fake);
+    Si4735I2CDev i2c(&fake);
+    Si4735SPIDev spi(&fake);
+    bool good;
+
+    //RESET and GPO2/INT, as in the constructor calls above
+    gpio.open("/dev/gpiochip0");
+    gpio.map(9, 17);
+    gpio.map(2, 27);
+    i2c.open("/dev/i2c-1", FAKE_I2C_ADDRESS);
+    spi.open("/dev/spidev0.0");
+
+    good = check("i2c-dev", &i2c, SI4735_INTERFACE_I2C);
+    good = check("spidev", &spi, SI4735_INTERFACE_SPI) && good;
+    printf("gpio: %lu ioctls, %lu syscalls\n", gpioCalls, gpio.getSyscalls());
+
+    return good ? 0 : 1;
+}